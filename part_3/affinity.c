@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+
+#define MAX_LISTED_CPUS 256
+
+/* sleep lateness is accounted separately for each kind of thread */
+#define JITTER_PRODUCERS 0
+#define JITTER_PADS 1
+#define JITTER_OTHERS 2
+
+typedef struct {
+    int cpus[MAX_LISTED_CPUS];
+    int count;
+} CpuList;
+
+/* lateness of timed sleeps in microseconds, i.e. actual minus requested sleep duration */
+int jitterEnabled = FALSE;
+Histogram sleepLateness[3];
+atomic_long maxSleepLateness[3];
+__thread int jitterRole = JITTER_OTHERS;
+
+int ParseCpuList(const char *text, CpuList *list);
+int CpuFor(CpuList *list, int i);
+int CreateThread(pthread_t *thread, void *(*function)(void *), void *arg, int cpu, int priority);
+void RecordSleepLateness(const struct timespec *expected);
+void PrintJitterReport();
+
+/* parse "0,2,4-7" into a list of CPUs, returns FALSE on a malformed list */
+int ParseCpuList(const char *text, CpuList *list) {
+    list->count = 0;
+    while (*text != '\0') {
+        char *end;
+        long first = strtol(text, &end, 10);
+        long last = first;
+        if (end == text || first < 0) {
+            return FALSE;
+        }
+        if (*end == '-') {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+            if (end == text || last < first) {
+                return FALSE;
+            }
+        }
+        for (long cpu = first; cpu <= last && list->count < MAX_LISTED_CPUS; cpu++) {
+            list->cpus[list->count++] = cpu;
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return FALSE;
+        }
+        text = end;
+    }
+    return TRUE;
+}
+
+/* the CPU of the i-th thread of a role, the list is used round robin, -1 if not pinned */
+int CpuFor(CpuList *list, int i) {
+    if (list->count == 0) {
+        return -1;
+    }
+    return list->cpus[i % list->count];
+}
+
+/*
+ * pthread_create pinned to cpu (-1 for any) and, if priority > 0, scheduled SCHED_FIFO with that priority.
+ * Falls back to default attributes with a warning when the system refuses them (e.g. no CAP_SYS_NICE).
+ */
+int CreateThread(pthread_t *thread, void *(*function)(void *), void *arg, int cpu, int priority) {
+    if (cpu < 0 && priority <= 0) {
+        return pthread_create(thread, NULL, function, arg);
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_attr_setaffinity_np(&attr, sizeof (set), &set);
+    }
+    if (priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof (param));
+        param.sched_priority = priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    int res = pthread_create(thread, &attr, function, arg);
+    pthread_attr_destroy(&attr);
+    if (res != 0) {
+        fprintf(stderr, "could not pin a thread to cpu %d with priority %d (%s), using the defaults\n", cpu, priority, strerror(res));
+        res = pthread_create(thread, NULL, function, arg);
+    }
+    return res;
+}
+
+/* account how late the calling thread woke up from a timed sleep that was due at expected */
+void RecordSleepLateness(const struct timespec *expected) {
+    if (!jitterEnabled) {
+        return;
+    }
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    long late = (now.tv_sec - expected->tv_sec) * 1000000L + (now.tv_usec - expected->tv_nsec / 1000);
+
+    HistogramAdd(&sleepLateness[jitterRole], late);
+    long max = atomic_load_explicit(&maxSleepLateness[jitterRole], memory_order_relaxed);
+    while (late > max && !atomic_compare_exchange_weak(&maxSleepLateness[jitterRole], &max, late)) {
+    }
+}
+
+void PrintJitterReport() {
+    const char *roles[] = {"producers", "pads", "others"};
+
+    printf("Sleep jitter (actual - requested duration, microseconds)\n");
+    printf("%-10s %10s %10s %10s %10s %10s\n", "Threads", "Sleeps", "Mean", "p50", "p99", "Max");
+    for (int i = 0; i < 3; i++) {
+        long count = atomic_load(&sleepLateness[i].total);
+        printf("%-10s %10ld %10.1f %10ld %10ld %10ld\n", roles[i], count,
+                count ? (double) atomic_load(&sleepLateness[i].sum) / count : 0.0,
+                HistogramPercentile(&sleepLateness[i], 0.5), HistogramPercentile(&sleepLateness[i], 0.99),
+                atomic_load(&maxSleepLateness[i]));
+    }
+    printf("(percentiles are capped at %d us)\n", HISTOGRAM_BUCKETS - 1);
+}
@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+/*
+ * Random variates for the arrival processes and service times. Every producer draws from its own
+ * generator state, and samples are generated SAMPLE_BATCH at a time so the dispatch on the kind of
+ * distribution and the setup of the transforms are paid once per batch instead of once per job.
+ */
+
+#define SAMPLE_BATCH 64
+#define MAX_EMPIRICAL_VALUES 100000
+
+/* kinds of distributions, all values are in seconds */
+#define DIST_NONE 0        /* not configured, the caller's default applies */
+#define DIST_FIXED 1       /* a: value */
+#define DIST_EXPONENTIAL 2 /* a: mean */
+#define DIST_LOGNORMAL 3   /* a: mean, b: sigma of the underlying normal */
+#define DIST_EMPIRICAL 4   /* values drawn uniformly from the listed samples */
+#define DIST_MMPP 5        /* interarrivals of a 2-state MMPP, a/b: rates, c/d: mean time in each state */
+
+typedef struct {
+    int kind;
+    double a, b, c, d;
+    double *values;
+    int valueCount;
+} Distribution;
+
+typedef struct {
+    const Distribution *dist;
+    double batch[SAMPLE_BATCH];
+    int next;         /* batch[next] is the next sample, SAMPLE_BATCH when the batch is used up */
+    int state;        /* MMPP state */
+    double stateLeft; /* seconds left in the MMPP state, negative before the first one is drawn */
+} Sampler;
+
+uint64_t NextRandom(uint64_t *state);
+double NextUniform(uint64_t *state);
+int ParseDistribution(const char *spec, Distribution *dist, int arrival);
+void SamplerInit(Sampler *sampler, const Distribution *dist);
+double Sample(Sampler *sampler, uint64_t *rng);
+int SaveSampler(const Sampler *sampler, FILE *fp);
+int LoadSampler(Sampler *sampler, FILE *fp);
+double DistributionMean(const Distribution *dist);
+double DistributionScv(const Distribution *dist);
+
+/* splitmix64, small and fast, and its whole state is one number that a checkpoint can save */
+uint64_t NextRandom(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* uniform in (0, 1], never 0 so its logarithm is finite */
+double NextUniform(uint64_t *state) {
+    return ((NextRandom(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static int LoadEmpirical(const char *path, Distribution *dist) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return FALSE;
+    }
+    int capacity = 1024;
+    dist->values = (double *) malloc(capacity * sizeof (double));
+    dist->valueCount = 0;
+    double value;
+    while (dist->valueCount < MAX_EMPIRICAL_VALUES && fscanf(fp, "%lf", &value) == 1) {
+        if (value < 0) {
+            continue;
+        }
+        if (dist->valueCount == capacity) {
+            capacity *= 2;
+            dist->values = (double *) realloc(dist->values, capacity * sizeof (double));
+        }
+        dist->values[dist->valueCount++] = value;
+    }
+    fclose(fp);
+    return dist->valueCount > 0;
+}
+
+/*
+ * Parse "kind:parameters", returns FALSE on a malformed spec. Arrival processes are
+ * poisson:<jobs per s>, deterministic:<s between jobs>, mmpp:<rate1>,<rate2>,<s in state 1>,<s in state 2>
+ * and empirical:<file of interarrival times>. Service times are fixed:<s>, exponential:<mean s>,
+ * lognormal:<mean s>,<sigma> and empirical:<file of service times>.
+ */
+int ParseDistribution(const char *spec, Distribution *dist, int arrival) {
+    memset(dist, 0, sizeof (*dist));
+    const char *colon = strchr(spec, ':');
+    if (colon == NULL) {
+        return FALSE;
+    }
+    const char *args = colon + 1;
+    size_t len = colon - spec;
+
+    if (!strncmp(spec, "empirical", len) && len == 9) {
+        dist->kind = DIST_EMPIRICAL;
+        return LoadEmpirical(args, dist);
+    }
+
+    int count = sscanf(args, "%lf,%lf,%lf,%lf", &dist->a, &dist->b, &dist->c, &dist->d);
+    if (arrival && !strncmp(spec, "poisson", len) && len == 7 && count == 1 && dist->a > 0) {
+        dist->kind = DIST_EXPONENTIAL;
+        dist->a = 1 / dist->a;
+    } else if (arrival && !strncmp(spec, "deterministic", len) && len == 13 && count == 1 && dist->a > 0) {
+        dist->kind = DIST_FIXED;
+    } else if (arrival && !strncmp(spec, "mmpp", len) && len == 4 && count == 4 && dist->a >= 0 && dist->b >= 0 &&
+            dist->a + dist->b > 0 && dist->c > 0 && dist->d > 0) {
+        dist->kind = DIST_MMPP;
+    } else if (!arrival && !strncmp(spec, "fixed", len) && len == 5 && count == 1 && dist->a > 0) {
+        dist->kind = DIST_FIXED;
+    } else if (!arrival && !strncmp(spec, "exponential", len) && len == 11 && count == 1 && dist->a > 0) {
+        dist->kind = DIST_EXPONENTIAL;
+    } else if (!arrival && !strncmp(spec, "lognormal", len) && len == 9 && count == 2 && dist->a > 0 && dist->b >= 0) {
+        dist->kind = DIST_LOGNORMAL;
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void SamplerInit(Sampler *sampler, const Distribution *dist) {
+    sampler->dist = dist;
+    sampler->next = SAMPLE_BATCH;
+    sampler->state = 0;
+    sampler->stateLeft = -1;
+}
+
+/* time to the next arrival of the MMPP, switching states as their sojourn times run out */
+static double SampleMmpp(Sampler *sampler, uint64_t *rng) {
+    const Distribution *d = sampler->dist;
+    double waited = 0;
+    while (TRUE) {
+        double rate = sampler->state == 0 ? d->a : d->b;
+        if (sampler->stateLeft < 0) {
+            sampler->stateLeft = -(sampler->state == 0 ? d->c : d->d) * log(NextUniform(rng));
+        }
+        double next = rate > 0 ? -log(NextUniform(rng)) / rate : sampler->stateLeft + 1;
+        if (next <= sampler->stateLeft) {
+            sampler->stateLeft -= next;
+            return waited + next;
+        }
+        // exponential interarrivals are memoryless, so the draw can be dropped at the switch
+        waited += sampler->stateLeft;
+        sampler->state = !sampler->state;
+        sampler->stateLeft = -1;
+    }
+}
+
+static void FillBatch(Sampler *sampler, uint64_t *rng) {
+    const Distribution *d = sampler->dist;
+    double *out = sampler->batch;
+
+    switch (d->kind) {
+        case DIST_FIXED:
+            for (int i = 0; i < SAMPLE_BATCH; i++) {
+                out[i] = d->a;
+            }
+            break;
+        case DIST_EXPONENTIAL:
+            for (int i = 0; i < SAMPLE_BATCH; i++) {
+                out[i] = -d->a * log(NextUniform(rng));
+            }
+            break;
+        case DIST_LOGNORMAL:
+        {
+            // Box-Muller gives two normals per pair of uniforms, mu is chosen so the mean is a
+            double mu = log(d->a) - d->b * d->b / 2;
+            for (int i = 0; i < SAMPLE_BATCH; i += 2) {
+                double r = sqrt(-2 * log(NextUniform(rng)));
+                double theta = 2 * M_PI * NextUniform(rng);
+                out[i] = exp(mu + d->b * r * cos(theta));
+                out[i + 1] = exp(mu + d->b * r * sin(theta));
+            }
+            break;
+        }
+        case DIST_EMPIRICAL:
+            for (int i = 0; i < SAMPLE_BATCH; i++) {
+                out[i] = d->values[NextRandom(rng) % d->valueCount];
+            }
+            break;
+        case DIST_MMPP:
+            for (int i = 0; i < SAMPLE_BATCH; i++) {
+                out[i] = SampleMmpp(sampler, rng);
+            }
+            break;
+        default:
+            memset(out, 0, sizeof (sampler->batch));
+    }
+    sampler->next = 0;
+}
+
+/* the next sample in seconds */
+double Sample(Sampler *sampler, uint64_t *rng) {
+    if (sampler->next == SAMPLE_BATCH) {
+        FillBatch(sampler, rng);
+    }
+    return sampler->batch[sampler->next++];
+}
+
+/* write the samples drawn but not taken yet and the MMPP state, so a restored producer continues the same sequence */
+int SaveSampler(const Sampler *sampler, FILE *fp) {
+    int32_t next = sampler->next, state = sampler->state;
+    return fwrite(sampler->batch, sizeof (sampler->batch), 1, fp) == 1 && fwrite(&next, sizeof (next), 1, fp) == 1 &&
+            fwrite(&state, sizeof (state), 1, fp) == 1 && fwrite(&sampler->stateLeft, sizeof (double), 1, fp) == 1;
+}
+
+/* read what SaveSampler wrote into a sampler initialized with its distribution */
+int LoadSampler(Sampler *sampler, FILE *fp) {
+    int32_t next, state;
+    if (fread(sampler->batch, sizeof (sampler->batch), 1, fp) != 1 || fread(&next, sizeof (next), 1, fp) != 1 ||
+            fread(&state, sizeof (state), 1, fp) != 1 || fread(&sampler->stateLeft, sizeof (double), 1, fp) != 1 ||
+            next < 0 || next > SAMPLE_BATCH) {
+        return FALSE;
+    }
+    sampler->next = next;
+    sampler->state = state;
+    return TRUE;
+}
+
+/* mean of the samples, for an MMPP the mean interarrival time */
+double DistributionMean(const Distribution *dist) {
+    double sum = 0;
+    switch (dist->kind) {
+        case DIST_FIXED:
+        case DIST_EXPONENTIAL:
+        case DIST_LOGNORMAL:
+            return dist->a;
+        case DIST_EMPIRICAL:
+            for (int i = 0; i < dist->valueCount; i++) {
+                sum += dist->values[i];
+            }
+            return sum / dist->valueCount;
+        case DIST_MMPP:
+            return (dist->c + dist->d) / (dist->a * dist->c + dist->b * dist->d);
+        default:
+            return 0;
+    }
+}
+
+/* squared coefficient of variation (variance / mean^2) of the samples, the MMPP's is not computed */
+double DistributionScv(const Distribution *dist) {
+    double mean = DistributionMean(dist), sum = 0;
+    switch (dist->kind) {
+        case DIST_EXPONENTIAL:
+        case DIST_MMPP:
+            return 1;
+        case DIST_LOGNORMAL:
+            return exp(dist->b * dist->b) - 1;
+        case DIST_EMPIRICAL:
+            for (int i = 0; i < dist->valueCount; i++) {
+                sum += (dist->values[i] - mean) * (dist->values[i] - mean);
+            }
+            return mean > 0 ? sum / dist->valueCount / (mean * mean) : 0;
+        default:
+            return 0;
+    }
+}
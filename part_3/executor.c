@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+/*
+ * M:N executor: many lightweight tasks run on a few worker threads. A task is a state machine,
+ * its step function does a bounded amount of work and returns how many milliseconds later it
+ * wants to run again, or -1 when it is done. Waiting is done by the executor's timer heap instead
+ * of by a blocked thread, so a task costs a few words of memory instead of a stack.
+ */
+
+typedef struct Task_t {
+    long (*step)(struct Task_t *task);
+    void *arg;
+    long wakeAt;       /* absolute milliseconds, see ExecutorNow */
+    int heapIndex;     /* position in the timer heap, -1 when not in it */
+    int running;       /* a worker is running the step right now */
+    int wakeRequested; /* ExecutorWake was called while the step was running */
+} Task;
+
+pthread_mutex_t executorMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t executorCond = PTHREAD_COND_INITIALIZER;
+Task **timerHeap;
+int timerHeapSize;
+int timerHeapCapacity;
+int executorStopping;
+pthread_t *executorWorkers;
+int executorWorkerCount;
+
+long ExecutorNow();
+void ExecutorSchedule(Task *task, long delay);
+void ExecutorWake(Task *task);
+void ExecutorStart(int workers);
+void ExecutorStop();
+void *ExecutorWorker(void *arg);
+
+long ExecutorNow() {
+    struct timeval tp;
+    gettimeofday(&tp, NULL);
+    return tp.tv_sec * 1000L + tp.tv_usec / 1000;
+}
+
+static void HeapSwap(int a, int b) {
+    Task *t = timerHeap[a];
+    timerHeap[a] = timerHeap[b];
+    timerHeap[b] = t;
+    timerHeap[a]->heapIndex = a;
+    timerHeap[b]->heapIndex = b;
+}
+
+static void HeapUp(int i) {
+    while (i > 0 && timerHeap[(i - 1) / 2]->wakeAt > timerHeap[i]->wakeAt) {
+        HeapSwap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void HeapDown(int i) {
+    while (TRUE) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+        if (left < timerHeapSize && timerHeap[left]->wakeAt < timerHeap[smallest]->wakeAt) {
+            smallest = left;
+        }
+        if (right < timerHeapSize && timerHeap[right]->wakeAt < timerHeap[smallest]->wakeAt) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        HeapSwap(i, smallest);
+        i = smallest;
+    }
+}
+
+/* called with executorMutex held */
+static void HeapPush(Task *task) {
+    if (timerHeapSize == timerHeapCapacity) {
+        timerHeapCapacity = timerHeapCapacity ? timerHeapCapacity * 2 : 64;
+        timerHeap = (Task **) realloc(timerHeap, timerHeapCapacity * sizeof (Task *));
+    }
+    task->heapIndex = timerHeapSize;
+    timerHeap[timerHeapSize++] = task;
+    HeapUp(task->heapIndex);
+    // the new task may be due before the one the workers are waiting for
+    if (task->heapIndex == 0) {
+        pthread_cond_signal(&executorCond);
+    }
+}
+
+/* called with executorMutex held */
+static Task *HeapPop() {
+    Task *top = timerHeap[0];
+    timerHeapSize--;
+    if (timerHeapSize > 0) {
+        timerHeap[0] = timerHeap[timerHeapSize];
+        timerHeap[0]->heapIndex = 0;
+        HeapDown(0);
+    }
+    top->heapIndex = -1;
+    return top;
+}
+
+/* run the task's step delay milliseconds from now, the task must not be scheduled already */
+void ExecutorSchedule(Task *task, long delay) {
+    pthread_mutex_lock(&executorMutex);
+    task->wakeAt = ExecutorNow() + delay;
+    task->running = FALSE;
+    task->wakeRequested = FALSE;
+    HeapPush(task);
+    pthread_mutex_unlock(&executorMutex);
+}
+
+/* run the task's step as soon as possible, e.g. when something it waits for happened */
+void ExecutorWake(Task *task) {
+    pthread_mutex_lock(&executorMutex);
+    if (task->running) {
+        task->wakeRequested = TRUE;
+    } else if (task->heapIndex >= 0) {
+        task->wakeAt = ExecutorNow();
+        HeapUp(task->heapIndex);
+        if (task->heapIndex == 0) {
+            pthread_cond_signal(&executorCond);
+        }
+    }
+    pthread_mutex_unlock(&executorMutex);
+}
+
+void *ExecutorWorker(void *arg) {
+    TraceThread("Worker");
+
+    pthread_mutex_lock(&executorMutex);
+    while (!executorStopping) {
+        if (timerHeapSize == 0) {
+            pthread_cond_wait(&executorCond, &executorMutex);
+            continue;
+        }
+        long now = ExecutorNow();
+        if (timerHeap[0]->wakeAt > now) {
+            struct timespec timetoexpire;
+            timetoexpire.tv_sec = timerHeap[0]->wakeAt / 1000;
+            timetoexpire.tv_nsec = (timerHeap[0]->wakeAt % 1000) * 1000000L;
+            pthread_cond_timedwait(&executorCond, &executorMutex, &timetoexpire);
+            continue;
+        }
+
+        Task *task = HeapPop();
+        task->running = TRUE;
+        // let another worker take the next due task while this one runs
+        if (timerHeapSize > 0) {
+            pthread_cond_signal(&executorCond);
+        }
+        pthread_mutex_unlock(&executorMutex);
+
+        long delay = task->step(task);
+
+        pthread_mutex_lock(&executorMutex);
+        task->running = FALSE;
+        if (delay >= 0) {
+            task->wakeAt = task->wakeRequested ? ExecutorNow() : ExecutorNow() + delay;
+            task->wakeRequested = FALSE;
+            HeapPush(task);
+        }
+    }
+    pthread_mutex_unlock(&executorMutex);
+
+    return NULL;
+}
+
+void ExecutorStart(int workers) {
+    executorStopping = FALSE;
+    executorWorkerCount = workers;
+    executorWorkers = (pthread_t *) malloc(workers * sizeof (pthread_t));
+    for (int i = 0; i < workers; i++) {
+        pthread_create(&executorWorkers[i], NULL, ExecutorWorker, NULL);
+    }
+}
+
+/* stop the workers once their current steps return, tasks still waiting are dropped */
+void ExecutorStop() {
+    pthread_mutex_lock(&executorMutex);
+    executorStopping = TRUE;
+    pthread_cond_broadcast(&executorCond);
+    pthread_mutex_unlock(&executorMutex);
+
+    for (int i = 0; i < executorWorkerCount; i++) {
+        pthread_join(executorWorkers[i], NULL);
+    }
+    free(executorWorkers);
+    free(timerHeap);
+    timerHeap = NULL;
+    timerHeapSize = 0;
+    timerHeapCapacity = 0;
+}
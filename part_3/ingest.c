@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Ingestion ring in POSIX shared memory, for jobs submitted by processes outside the simulation.
+ * The segment is a small header followed by a Mailbox, which holds no pointers and works wherever
+ * each process maps it. Any number of client processes push job records (with a single one the
+ * compare-and-swap never fails, so it runs as a single producer ring), and the first control tower
+ * takes them in batches. A client fills in only the type, as the job type's log letter ('L', 'D',
+ * 'A' or 'E'), and the duration. The tower stamps the rest when it admits the job. Clients include
+ * queue.c, mailbox.c and this file, see ingest_client.c.
+ */
+
+#define INGEST_MAGIC 0x4a4f4253 /* "JOBS" */
+#define INGEST_VERSION 1
+#define INGEST_HEADER_SIZE 64 /* the mailbox starts on its own cache line */
+#define INGEST_BATCH 256      /* jobs the tower takes from the ring per pass */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t jobSize;  /* sizeof (Job) of the simulator, a client built with another layout is refused */
+    uint32_t capacity;
+    uint64_t size;     /* bytes of the segment */
+    atomic_int ready;  /* set once the mailbox is initialized */
+    atomic_int closed; /* set once the simulator takes no more jobs */
+} IngestHeader;
+
+typedef struct {
+    IngestHeader *header;
+    Mailbox *mailbox;
+    size_t size;
+    char name[64]; /* with the leading slash shm_open wants */
+} IngestRing;
+
+int IngestCreate(IngestRing *ring, const char *name, int capacity);
+int IngestAttach(IngestRing *ring, const char *name);
+int IngestSubmit(IngestRing *ring, char letter, int duration);
+int IngestSubmitBatch(IngestRing *ring, const Job *jobs, int count);
+int IngestClosed(IngestRing *ring);
+void IngestClose(IngestRing *ring);
+void IngestDetach(IngestRing *ring);
+void IngestDestroy(IngestRing *ring);
+
+static void IngestName(IngestRing *ring, const char *name) {
+    snprintf(ring->name, sizeof (ring->name), name[0] == '/' ? "%s" : "/%s", name);
+}
+
+/* create the segment for the simulator, replacing one left by an earlier run; returns FALSE on failure */
+int IngestCreate(IngestRing *ring, const char *name, int capacity) {
+    IngestName(ring, name);
+    shm_unlink(ring->name);
+    int fd = shm_open(ring->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return FALSE;
+    }
+    ring->size = INGEST_HEADER_SIZE + MailboxSize(capacity);
+    void *base = ftruncate(fd, ring->size) == 0 ? mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(ring->name);
+        return FALSE;
+    }
+
+    ring->header = (IngestHeader *) base;
+    ring->mailbox = (Mailbox *) ((char *) base + INGEST_HEADER_SIZE);
+    MailboxInit(ring->mailbox, capacity);
+    ring->header->magic = INGEST_MAGIC;
+    ring->header->version = INGEST_VERSION;
+    ring->header->jobSize = sizeof (Job);
+    ring->header->capacity = ring->mailbox->mask + 1;
+    ring->header->size = ring->size;
+    atomic_init(&ring->header->closed, FALSE);
+    atomic_store_explicit(&ring->header->ready, TRUE, memory_order_release);
+    return TRUE;
+}
+
+/* map the segment of a running simulator; returns FALSE if there is none or it has another layout */
+int IngestAttach(IngestRing *ring, const char *name) {
+    IngestName(ring, name);
+    int fd = shm_open(ring->name, O_RDWR, 0);
+    if (fd < 0) {
+        return FALSE;
+    }
+    struct stat st;
+    void *base = fstat(fd, &st) == 0 && (size_t) st.st_size > INGEST_HEADER_SIZE ?
+            mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED) {
+        return FALSE;
+    }
+
+    ring->header = (IngestHeader *) base;
+    ring->mailbox = (Mailbox *) ((char *) base + INGEST_HEADER_SIZE);
+    ring->size = st.st_size;
+    if (!atomic_load_explicit(&ring->header->ready, memory_order_acquire) || IngestClosed(ring) || ring->header->magic != INGEST_MAGIC ||
+            ring->header->version != INGEST_VERSION || ring->header->jobSize != sizeof (Job) || ring->header->size != ring->size) {
+        IngestDetach(ring);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* submit a job of the type with the log letter lasting duration ms; FALSE if the ring is full */
+int IngestSubmit(IngestRing *ring, char letter, int duration) {
+    Job j = {0};
+    j.type = letter;
+    j.duration = duration;
+    return MailboxPush(ring->mailbox, j);
+}
+
+/* submit count jobs, only their type letter and duration are used; FALSE, submitting none, unless all fit */
+int IngestSubmitBatch(IngestRing *ring, const Job *jobs, int count) {
+    return MailboxPushBatch(ring->mailbox, jobs, count);
+}
+
+/* whether the simulator stopped taking jobs, a client waiting on a full ring should give up then */
+int IngestClosed(IngestRing *ring) {
+    return atomic_load_explicit(&ring->header->closed, memory_order_acquire);
+}
+
+void IngestClose(IngestRing *ring) {
+    atomic_store_explicit(&ring->header->closed, TRUE, memory_order_release);
+}
+
+void IngestDetach(IngestRing *ring) {
+    munmap(ring->header, ring->size);
+    ring->header = NULL;
+    ring->mailbox = NULL;
+}
+
+/* called by the simulator at exit, clients still attached keep their mapping */
+void IngestDestroy(IngestRing *ring) {
+    IngestClose(ring);
+    IngestDetach(ring);
+    shm_unlink(ring->name);
+}
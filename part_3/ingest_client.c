@@ -0,0 +1,112 @@
+// Traffic generator for the simulation's shared memory ingestion ring (see ingest.c and --ingest in
+// project_2.c). It submits jobs as fast as the ring takes them, in batches of -b jobs, waits while the
+// ring is full, and reports the submission rate. Several can run at once against the same ring. It stops
+// early when the simulation stops taking jobs.
+//
+//   gcc -O2 ingest_client.c -o ingest_client
+//   ./project_2 --ingest spaceport &
+//   ./ingest_client [-n jobs] [-b batch] [-t type letters] [-d duration ms] [spaceport]
+#define _GNU_SOURCE
+#include <sched.h>
+#include <time.h>
+
+#include "queue.c"
+#include "mailbox.c"
+#include "ingest.c"
+
+#define MAX_BATCH 4096
+
+static double Seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = "spaceport";
+    const char *letters = "LDA";
+    long jobs = 1000000;
+    int batch = 64;
+    int duration = 0;
+
+    // -n (int) => jobs to submit
+    // -b (int) => jobs per submission, 1 submits them one at a time
+    // -t (letters) => the job types to cycle through, by their log letters
+    // -d (int) => duration of every job in milliseconds, 0 by default
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            jobs = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+        {
+            batch = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+        {
+            letters = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+        {
+            duration = atoi(argv[++i]);
+        }
+        else
+        {
+            name = argv[i];
+        }
+    }
+    if (batch < 1 || batch > MAX_BATCH || letters[0] == '\0')
+    {
+        fprintf(stderr, "invalid batch or type letters\n");
+        return 1;
+    }
+
+    IngestRing ring;
+    if (!IngestAttach(&ring, name))
+    {
+        fprintf(stderr, "no ingestion ring %s, is the simulation running with --ingest?\n", name);
+        return 1;
+    }
+    if ((uint32_t)batch > ring.header->capacity)
+    {
+        batch = ring.header->capacity;
+    }
+
+    static Job pending[MAX_BATCH];
+    size_t typeCount = strlen(letters);
+    long submitted = 0, full = 0;
+    double start = Seconds();
+    while (submitted < jobs)
+    {
+        int count = jobs - submitted < batch ? jobs - submitted : batch;
+        for (int i = 0; i < count; i++)
+        {
+            pending[i].type = letters[(submitted + i) % typeCount];
+            pending[i].duration = duration;
+        }
+        // the simulation pushes back through a full ring, wait for the tower to take some. A submit that
+        // got in just before the ring closed still counts.
+        int accepted;
+        while (!(accepted = count == 1 ? IngestSubmit(&ring, pending[0].type, duration) : IngestSubmitBatch(&ring, pending, count)) &&
+               !IngestClosed(&ring))
+        {
+            full++;
+            sched_yield();
+        }
+        if (!accepted)
+        {
+            fprintf(stderr, "the simulation stopped taking jobs\n");
+            break;
+        }
+        submitted += count;
+    }
+    double seconds = Seconds() - start;
+
+    printf("submitted %ld jobs to %s in %.3f s, %.0f jobs/s, waited on a full ring %ld times\n", submitted, ring.name, seconds,
+           seconds > 0 ? submitted / seconds : 0.0, full);
+    IngestDetach(&ring);
+    return 0;
+}
@@ -0,0 +1,564 @@
+// Streaming analyzer for the log.txt files the simulation writes (see WriteLog in project_2.c).
+// The log is mapped into memory and split into chunks at line boundaries, every thread aggregates its
+// chunk into its own statistics, which are merged at the end. Lines are parsed at the fixed column
+// offsets WriteLog prints them at, with a tokenizing fallback for lines that overflowed a column.
+// Pages are dropped as soon as they are parsed, so logs larger than RAM stream at disk bandwidth.
+//
+//   gcc -O2 -pthread log_analyzer.c -o log_analyzer
+//   ./log_analyzer [-j threads] [-w window seconds] [log.txt]
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define TRUE 1
+#define FALSE 0
+
+// job types by their log letter, as in the JOB_TYPES table of project_2.c
+#define TYPE_COUNT 5
+static const char typeLetters[TYPE_COUNT] = {'L', 'D', 'A', 'E', 'U'};
+static const char *typeNames[TYPE_COUNT] = {"landing", "launch", "assembly", "emergency", "unknown"};
+
+// turnaround times are whole seconds, one histogram bucket each, larger ones go to the last bucket
+#define TURNAROUND_BUCKETS 4096
+#define MAX_PADS 4096
+#define MAX_WINDOWS (1L << 20) // later windows are accounted to the last one
+#define PAD_NAME_SIZE 12
+
+// pages are released once every this many bytes have been parsed
+#define RELEASE_BYTES (64L << 20)
+
+// the columns of a line as WriteLog prints them, [start, end) offsets
+#define LINE_LENGTH 114
+#define COLUMN_TYPE 25
+#define COLUMN_REQUEST 27, 38
+#define COLUMN_END 39, 52
+#define COLUMN_TURNAROUND 53, 64
+#define COLUMN_PAD_START 65
+#define COLUMN_PAD_END 75
+#define COLUMN_INTAKE 76, 88
+#define COLUMN_PAD_WAIT 89, 101
+#define COLUMN_SERVICE 102, 114
+
+typedef struct
+{
+    long request;    // s
+    long end;        // s
+    long turnaround; // s
+    char pad[PAD_NAME_SIZE];
+    long intake;     // ms
+    long padWait;    // ms
+    long service;    // ms
+    int type;
+} Entry;
+
+typedef struct
+{
+    long jobs;
+    long intake;  // summed, ms
+    long padWait; // ms
+    long service; // ms
+    long turnaroundMax;
+    long turnaround[TURNAROUND_BUCKETS];
+} TypeStats;
+
+typedef struct
+{
+    char name[PAD_NAME_SIZE];
+    long jobs;
+    long busy; // ms
+} PadStats;
+
+typedef struct
+{
+    long jobs;
+    long turnaround; // summed, s
+    long busy;       // ms
+} WindowStats;
+
+typedef struct
+{
+    // the chunk of the log this thread parses
+    const char *begin;
+    const char *end;
+
+    long lines;
+    long malformed;
+    long firstRequest;
+    long lastEnd;
+    TypeStats types[TYPE_COUNT];
+    PadStats pads[MAX_PADS]; // open addressing by pad name
+    int padCount;
+    WindowStats *windows;
+    long windowCount;
+} Stats;
+
+const char *mapped;
+size_t mappedSize;
+long windowSeconds = 60;
+
+// parse a right-aligned integer between start and end, spaces before it are skipped
+static long ParseInt(const char *p, int start, int end, int *ok)
+{
+    const char *s = p + start;
+    const char *e = p + end;
+    while (s < e && *s == ' ')
+    {
+        s++;
+    }
+    int negative = s < e && *s == '-';
+    s += negative;
+    if (s == e)
+    {
+        *ok = FALSE;
+    }
+    long value = 0;
+    for (; s < e; s++)
+    {
+        unsigned digit = (unsigned)(*s - '0');
+        *ok &= digit < 10;
+        value = value * 10 + digit;
+    }
+    return negative ? -value : value;
+}
+
+// parse a right-aligned "%.3f" number of seconds between start and end into milliseconds
+static long ParseMillis(const char *p, int start, int end, int *ok)
+{
+    // the decimal point is always 4 characters before the end
+    *ok &= p[end - 4] == '.';
+    long seconds = ParseInt(p, start, end - 4, ok);
+    long millis = ParseInt(p, end - 3, end, ok);
+    // "-0.500" has no sign left in the seconds
+    return memchr(p + start, '-', end - 4 - start) != NULL ? seconds * 1000 - millis : seconds * 1000 + millis;
+}
+
+static int TypeIndex(char letter)
+{
+    for (int i = 0; i < TYPE_COUNT - 1; i++)
+    {
+        if (typeLetters[i] == letter)
+        {
+            return i;
+        }
+    }
+    return TYPE_COUNT - 1;
+}
+
+// a line at the fixed column offsets, returns FALSE if it does not have them
+static int ParseFixed(const char *line, long length, Entry *entry)
+{
+    if (length != LINE_LENGTH || line[COLUMN_TYPE + 1] != ' ')
+    {
+        return FALSE;
+    }
+    int ok = TRUE;
+    entry->type = TypeIndex(line[COLUMN_TYPE]);
+    entry->request = ParseInt(line, COLUMN_REQUEST, &ok);
+    entry->end = ParseInt(line, COLUMN_END, &ok);
+    entry->turnaround = ParseInt(line, COLUMN_TURNAROUND, &ok);
+    entry->intake = ParseMillis(line, COLUMN_INTAKE, &ok);
+    entry->padWait = ParseMillis(line, COLUMN_PAD_WAIT, &ok);
+    entry->service = ParseMillis(line, COLUMN_SERVICE, &ok);
+
+    const char *pad = line + COLUMN_PAD_START;
+    while (*pad == ' ' && pad < line + COLUMN_PAD_END)
+    {
+        pad++;
+    }
+    int padLength = line + COLUMN_PAD_END - pad;
+    if (padLength == 0 || padLength >= PAD_NAME_SIZE)
+    {
+        return FALSE;
+    }
+    memcpy(entry->pad, pad, padLength);
+    entry->pad[padLength] = '\0';
+    return ok;
+}
+
+// a line with a column wider than its width, split at the spaces instead
+static int ParseTokens(const char *line, long length, Entry *entry)
+{
+    char copy[256];
+    if (length >= (long)sizeof(copy))
+    {
+        return FALSE;
+    }
+    memcpy(copy, line, length);
+    copy[length] = '\0';
+
+    uint64_t id;
+    char type;
+    double intake, padWait, service;
+    if (sscanf(copy, "%" SCNu64 " %c %ld %ld %ld %11s %lf %lf %lf", &id, &type, &entry->request, &entry->end, &entry->turnaround,
+               entry->pad, &intake, &padWait, &service) != 9)
+    {
+        return FALSE;
+    }
+    entry->type = TypeIndex(type);
+    entry->intake = (long)(intake * 1000 + (intake < 0 ? -0.5 : 0.5));
+    entry->padWait = (long)(padWait * 1000 + (padWait < 0 ? -0.5 : 0.5));
+    entry->service = (long)(service * 1000 + (service < 0 ? -0.5 : 0.5));
+    return TRUE;
+}
+
+static PadStats *FindPad(Stats *stats, const char *name)
+{
+    unsigned hash = 5381;
+    for (const char *c = name; *c; c++)
+    {
+        hash = hash * 33 + (unsigned char)*c;
+    }
+    for (unsigned i = 0; i < MAX_PADS; i++)
+    {
+        PadStats *pad = &stats->pads[(hash + i) % MAX_PADS];
+        if (pad->name[0] == '\0')
+        {
+            strcpy(pad->name, name);
+            stats->padCount++;
+            return pad;
+        }
+        if (!strcmp(pad->name, name))
+        {
+            return pad;
+        }
+    }
+    return NULL;
+}
+
+static WindowStats *FindWindow(Stats *stats, long end)
+{
+    long window = end > 0 ? end / windowSeconds : 0;
+    if (window >= MAX_WINDOWS)
+    {
+        window = MAX_WINDOWS - 1;
+    }
+    if (window >= stats->windowCount)
+    {
+        long count = stats->windowCount ? stats->windowCount : 16;
+        while (count <= window)
+        {
+            count *= 2;
+        }
+        stats->windows = (WindowStats *)realloc(stats->windows, count * sizeof(WindowStats));
+        memset(stats->windows + stats->windowCount, 0, (count - stats->windowCount) * sizeof(WindowStats));
+        stats->windowCount = count;
+    }
+    return &stats->windows[window];
+}
+
+static void Account(Stats *stats, Entry *entry)
+{
+    TypeStats *type = &stats->types[entry->type];
+    type->jobs++;
+    type->intake += entry->intake;
+    type->padWait += entry->padWait;
+    type->service += entry->service;
+    type->turnaround[entry->turnaround < 0 ? 0 : entry->turnaround < TURNAROUND_BUCKETS ? entry->turnaround : TURNAROUND_BUCKETS - 1]++;
+    if (entry->turnaround > type->turnaroundMax)
+    {
+        type->turnaroundMax = entry->turnaround;
+    }
+
+    PadStats *pad = FindPad(stats, entry->pad);
+    if (pad != NULL)
+    {
+        pad->jobs++;
+        pad->busy += entry->service;
+    }
+
+    WindowStats *window = FindWindow(stats, entry->end);
+    window->jobs++;
+    window->turnaround += entry->turnaround;
+    window->busy += entry->service;
+
+    if (stats->lines == 0 || entry->request < stats->firstRequest)
+    {
+        stats->firstRequest = entry->request;
+    }
+    if (entry->end > stats->lastEnd)
+    {
+        stats->lastEnd = entry->end;
+    }
+    stats->lines++;
+}
+
+void *AnalyzeChunk(void *arg)
+{
+    Stats *stats = (Stats *)arg;
+    const char *line = stats->begin;
+    const char *released = (const char *)((uintptr_t)line & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1));
+
+    while (line < stats->end)
+    {
+        const char *newline = memchr(line, '\n', stats->end - line);
+        long length = (newline ? newline : stats->end) - line;
+
+        Entry entry;
+        if (length > 0 && strncmp(line, "EventID", 7) != 0)
+        {
+            if (ParseFixed(line, length, &entry) || ParseTokens(line, length, &entry))
+            {
+                Account(stats, &entry);
+            }
+            else
+            {
+                stats->malformed++;
+            }
+        }
+        line += length + 1;
+
+        // the parsed pages are not needed again, let the kernel drop them
+        if (line - released >= RELEASE_BYTES && line < stats->end)
+        {
+            long bytes = ((line - released) / RELEASE_BYTES) * RELEASE_BYTES;
+            madvise((void *)released, bytes, MADV_DONTNEED);
+            released += bytes;
+        }
+    }
+
+    return NULL;
+}
+
+static void Merge(Stats *into, Stats *from)
+{
+    for (int t = 0; t < TYPE_COUNT; t++)
+    {
+        TypeStats *a = &into->types[t];
+        TypeStats *b = &from->types[t];
+        a->jobs += b->jobs;
+        a->intake += b->intake;
+        a->padWait += b->padWait;
+        a->service += b->service;
+        a->turnaroundMax = b->turnaroundMax > a->turnaroundMax ? b->turnaroundMax : a->turnaroundMax;
+        for (int i = 0; i < TURNAROUND_BUCKETS; i++)
+        {
+            a->turnaround[i] += b->turnaround[i];
+        }
+    }
+    for (int i = 0; i < MAX_PADS; i++)
+    {
+        if (from->pads[i].name[0] != '\0')
+        {
+            PadStats *pad = FindPad(into, from->pads[i].name);
+            if (pad != NULL)
+            {
+                pad->jobs += from->pads[i].jobs;
+                pad->busy += from->pads[i].busy;
+            }
+        }
+    }
+    if (from->windowCount > 0)
+    {
+        FindWindow(into, (from->windowCount - 1) * windowSeconds);
+        for (long w = 0; w < from->windowCount; w++)
+        {
+            into->windows[w].jobs += from->windows[w].jobs;
+            into->windows[w].turnaround += from->windows[w].turnaround;
+            into->windows[w].busy += from->windows[w].busy;
+        }
+    }
+    if (from->lines > 0 && (into->lines == 0 || from->firstRequest < into->firstRequest))
+    {
+        into->firstRequest = from->firstRequest;
+    }
+    if (from->lastEnd > into->lastEnd)
+    {
+        into->lastEnd = from->lastEnd;
+    }
+    into->lines += from->lines;
+    into->malformed += from->malformed;
+}
+
+static long Percentile(TypeStats *type, double q)
+{
+    long rank = (long)(q * type->jobs + 0.5);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    long seen = 0;
+    for (int i = 0; i < TURNAROUND_BUCKETS; i++)
+    {
+        seen += type->turnaround[i];
+        if (seen >= rank)
+        {
+            return i;
+        }
+    }
+    return TURNAROUND_BUCKETS - 1;
+}
+
+static int ComparePads(const void *a, const void *b)
+{
+    const PadStats *x = (const PadStats *)a;
+    const PadStats *y = (const PadStats *)b;
+    if (strlen(x->name) != strlen(y->name))
+    {
+        return strlen(x->name) < strlen(y->name) ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+static void PrintReport(Stats *stats, const char *path, int threads, double seconds)
+{
+    long span = stats->lastEnd - stats->firstRequest;
+    if (span <= 0)
+    {
+        span = 1;
+    }
+
+    printf("%s: %ld jobs, %ld malformed lines, %ld s simulated, %.1f MB in %.3f s with %d threads (%.1f MB/s)\n", path, stats->lines,
+           stats->malformed, span, mappedSize / 1e6, seconds, threads, seconds > 0 ? mappedSize / 1e6 / seconds : 0.0);
+
+    printf("\n%-10s %10s %10s %8s %8s %8s %8s %14s %14s %14s\n", "Type", "Jobs", "Jobs/s", "p50 s", "p90 s", "p99 s", "Max s",
+           "Intake wait s", "Pad wait s", "Service s");
+    for (int t = 0; t < TYPE_COUNT; t++)
+    {
+        TypeStats *type = &stats->types[t];
+        if (type->jobs == 0)
+        {
+            continue;
+        }
+        printf("%-10s %10ld %10.4f %8ld %8ld %8ld %8ld %14.3f %14.3f %14.3f\n", typeNames[t], type->jobs, (double)type->jobs / span,
+               Percentile(type, 0.5), Percentile(type, 0.9), Percentile(type, 0.99), type->turnaroundMax,
+               type->intake / 1000.0 / type->jobs, type->padWait / 1000.0 / type->jobs, type->service / 1000.0 / type->jobs);
+    }
+
+    PadStats *pads = (PadStats *)malloc(stats->padCount * sizeof(PadStats));
+    int padCount = 0;
+    for (int i = 0; i < MAX_PADS; i++)
+    {
+        if (stats->pads[i].name[0] != '\0')
+        {
+            pads[padCount++] = stats->pads[i];
+        }
+    }
+    qsort(pads, padCount, sizeof(PadStats), ComparePads);
+    printf("\n%-10s %10s %12s %12s\n", "Pad", "Jobs", "Busy s", "Utilization");
+    for (int i = 0; i < padCount; i++)
+    {
+        printf("%-10s %10ld %12.3f %11.1f%%\n", pads[i].name, pads[i].jobs, pads[i].busy / 1000.0, 100.0 * pads[i].busy / 1000.0 / span);
+    }
+    free(pads);
+
+    printf("\n%-16s %10s %10s %16s %12s\n", "Window s", "Jobs", "Jobs/s", "Turnaround s", "Utilization");
+    for (long w = 0; w < stats->windowCount && w * windowSeconds <= stats->lastEnd; w++)
+    {
+        WindowStats *window = &stats->windows[w];
+        char range[32];
+        snprintf(range, sizeof(range), "%ld-%ld", w * windowSeconds, (w + 1) * windowSeconds);
+        printf("%-16s %10ld %10.4f %16.3f %11.1f%%\n", range, window->jobs, (double)window->jobs / windowSeconds,
+               window->jobs ? (double)window->turnaround / window->jobs : 0.0,
+               padCount ? 100.0 * window->busy / 1000.0 / windowSeconds / padCount : 0.0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = "log.txt";
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // -j (int) => threads parsing the log, one per CPU by default
+    // -w (int) => seconds per time window, 60 by default
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+        {
+            windowSeconds = atol(argv[++i]);
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    if (windowSeconds < 1)
+    {
+        windowSeconds = 1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        fprintf(stderr, "could not open %s\n", path);
+        return 1;
+    }
+    mappedSize = st.st_size;
+    if (mappedSize == 0)
+    {
+        printf("%s: empty\n", path);
+        return 0;
+    }
+    mapped = (const char *)mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        fprintf(stderr, "could not map %s\n", path);
+        return 1;
+    }
+    madvise((void *)mapped, mappedSize, MADV_SEQUENTIAL);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // split at line boundaries, a chunk starts after the newline that ends the previous one
+    if ((size_t)threads > mappedSize / 4096 + 1)
+    {
+        threads = mappedSize / 4096 + 1;
+    }
+    Stats *stats = (Stats *)calloc(threads, sizeof(Stats));
+    pthread_t *workers = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    const char *begin = mapped;
+    for (int i = 0; i < threads; i++)
+    {
+        const char *chunkEnd = i == threads - 1 ? mapped + mappedSize : mapped + mappedSize / threads * (i + 1);
+        if (chunkEnd < begin)
+        {
+            chunkEnd = begin;
+        }
+        const char *newline = chunkEnd < mapped + mappedSize ? memchr(chunkEnd, '\n', mapped + mappedSize - chunkEnd) : NULL;
+        if (i < threads - 1)
+        {
+            chunkEnd = newline ? newline + 1 : mapped + mappedSize;
+        }
+        stats[i].begin = begin;
+        stats[i].end = chunkEnd;
+        begin = chunkEnd;
+        pthread_create(&workers[i], NULL, AnalyzeChunk, &stats[i]);
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+        if (i > 0)
+        {
+            Merge(&stats[0], &stats[i]);
+            free(stats[i].windows);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    PrintReport(&stats[0], path, threads, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+    munmap((void *)mapped, mappedSize);
+    free(stats[0].windows);
+    free(stats);
+    free(workers);
+    return 0;
+}
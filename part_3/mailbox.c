@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/*
+ * Bounded lock-free queue of jobs with many producers and one consumer. Every cell carries a
+ * sequence number that says whose turn it is: a producer claims the cell at the tail with one
+ * compare-and-swap and publishes the job by advancing the cell's sequence, the consumer takes the
+ * cell at the head once its sequence shows the job is there. Nobody waits on a lock, so a tower
+ * handing jobs to another never stalls behind it. The mailbox is one block of memory without
+ * pointers.
+ */
+
+#define MAILBOX_CACHE_LINE 64
+
+typedef struct {
+    atomic_size_t sequence; /* position + 1 once the job at position is written, position + capacity once it is taken */
+    Job job;
+} MailboxCell;
+
+typedef struct {
+    size_t mask; /* capacity - 1, the capacity is a power of two */
+    _Alignas(MAILBOX_CACHE_LINE) atomic_size_t tail; /* next position a producer claims */
+    _Alignas(MAILBOX_CACHE_LINE) size_t head;        /* next position the consumer takes, only it touches this */
+    _Alignas(MAILBOX_CACHE_LINE) MailboxCell cells[];
+} Mailbox;
+
+size_t MailboxSize(int capacity);
+void MailboxInit(Mailbox *mailbox, int capacity);
+Mailbox *MailboxCreate(int capacity);
+int MailboxPush(Mailbox *mailbox, Job job);
+int MailboxPushBatch(Mailbox *mailbox, const Job *jobs, int count);
+int MailboxPop(Mailbox *mailbox, Job *job);
+Job *MailboxPeek(Mailbox *mailbox);
+int MailboxEmpty(Mailbox *mailbox);
+
+/* the capacity rounded up to a power of two */
+static size_t MailboxCapacity(int capacity) {
+    size_t rounded = 1;
+    while (rounded < (size_t) capacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+/* bytes taken by a mailbox of the capacity */
+size_t MailboxSize(int capacity) {
+    return sizeof (Mailbox) + MailboxCapacity(capacity) * sizeof (MailboxCell);
+}
+
+void MailboxInit(Mailbox *mailbox, int capacity) {
+    size_t rounded = MailboxCapacity(capacity);
+    mailbox->mask = rounded - 1;
+    atomic_init(&mailbox->tail, 0);
+    mailbox->head = 0;
+    for (size_t i = 0; i < rounded; i++) {
+        atomic_init(&mailbox->cells[i].sequence, i);
+    }
+}
+
+Mailbox *MailboxCreate(int capacity) {
+    Mailbox *mailbox = (Mailbox *) aligned_alloc(MAILBOX_CACHE_LINE, (MailboxSize(capacity) + MAILBOX_CACHE_LINE - 1) & ~(size_t) (MAILBOX_CACHE_LINE - 1));
+    if (mailbox != NULL) {
+        MailboxInit(mailbox, capacity);
+    }
+    return mailbox;
+}
+
+/* called by any thread, returns FALSE if the mailbox is full */
+int MailboxPush(Mailbox *mailbox, Job job) {
+    size_t position = atomic_load_explicit(&mailbox->tail, memory_order_relaxed);
+    while (TRUE) {
+        MailboxCell *cell = &mailbox->cells[position & mailbox->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t turn = (intptr_t) sequence - (intptr_t) position;
+        if (turn == 0) {
+            // the cell is free, claim it (a failed exchange reloads position)
+            if (atomic_compare_exchange_weak_explicit(&mailbox->tail, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                cell->job = job;
+                atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+                return TRUE;
+            }
+        } else if (turn < 0) {
+            // the consumer has not taken the job a lap ago yet
+            return FALSE;
+        } else {
+            // another producer claimed the cell first
+            position = atomic_load_explicit(&mailbox->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/* push count jobs with one compare-and-swap, called by any thread; returns FALSE, pushing none, unless all fit */
+int MailboxPushBatch(Mailbox *mailbox, const Job *jobs, int count) {
+    if (count <= 0) {
+        return TRUE;
+    }
+    if ((size_t) count > mailbox->mask + 1) {
+        return FALSE;
+    }
+    size_t position = atomic_load_explicit(&mailbox->tail, memory_order_relaxed);
+    while (TRUE) {
+        // the consumer frees the cells in order, so the range is free once its last cell is
+        MailboxCell *last = &mailbox->cells[(position + count - 1) & mailbox->mask];
+        size_t sequence = atomic_load_explicit(&last->sequence, memory_order_acquire);
+        intptr_t turn = (intptr_t) sequence - (intptr_t) (position + count - 1);
+        if (turn == 0) {
+            if (atomic_compare_exchange_weak_explicit(&mailbox->tail, &position, position + count, memory_order_relaxed, memory_order_relaxed)) {
+                for (int i = 0; i < count; i++) {
+                    MailboxCell *cell = &mailbox->cells[(position + i) & mailbox->mask];
+                    cell->job = jobs[i];
+                    atomic_store_explicit(&cell->sequence, position + i + 1, memory_order_release);
+                }
+                return TRUE;
+            }
+        } else if (turn < 0) {
+            return FALSE;
+        } else {
+            position = atomic_load_explicit(&mailbox->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/* called by the consumer only, returns FALSE if the mailbox is empty */
+int MailboxPop(Mailbox *mailbox, Job *job) {
+    MailboxCell *cell = &mailbox->cells[mailbox->head & mailbox->mask];
+    size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    if (sequence != mailbox->head + 1) {
+        return FALSE;
+    }
+    *job = cell->job;
+    atomic_store_explicit(&cell->sequence, mailbox->head + mailbox->mask + 1, memory_order_release);
+    mailbox->head++;
+    return TRUE;
+}
+
+/* the job MailboxPop takes next, left in the mailbox, NULL if it is empty; called by the consumer only */
+Job *MailboxPeek(Mailbox *mailbox) {
+    MailboxCell *cell = &mailbox->cells[mailbox->head & mailbox->mask];
+    if (atomic_load_explicit(&cell->sequence, memory_order_acquire) != mailbox->head + 1) {
+        return NULL;
+    }
+    return &cell->job;
+}
+
+/* called by the consumer only */
+int MailboxEmpty(Mailbox *mailbox) {
+    MailboxCell *cell = &mailbox->cells[mailbox->head & mailbox->mask];
+    return atomic_load_explicit(&cell->sequence, memory_order_acquire) != mailbox->head + 1;
+}
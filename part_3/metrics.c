@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+
+/* one bucket per value from 0 to HISTOGRAM_BUCKETS - 1, larger values go to the last bucket */
+#define HISTOGRAM_BUCKETS 1024
+
+typedef struct {
+    atomic_long counts[HISTOGRAM_BUCKETS];
+    atomic_long total;
+    atomic_long sum;
+} Histogram;
+
+/*
+ * the time one thread spent waiting for mutexes taken with LockMutex. Only the thread writes its
+ * counters, each on a cache line of its own, so counting a lock does not share a line with the other
+ * threads; LockTotals sums the counters of every thread that took a lock.
+ */
+typedef struct LockCounters {
+    atomic_long acquisitions;
+    atomic_long contentions;
+    atomic_long waitNanos;
+    struct LockCounters *next;
+} LockCounters;
+
+_Atomic(LockCounters *) lockCounterList;
+__thread LockCounters *lockCounters;
+
+/* the metrics server answers every connection with a snapshot written by this callback */
+typedef void (*SnapshotWriter)(FILE *out, int prometheus);
+
+char metricsSocketPath[108];
+int metricsSocket = -1;
+atomic_int metricsStopping;
+pthread_t metricsThread;
+SnapshotWriter metricsWriter;
+
+void HistogramAdd(Histogram *h, long value);
+long HistogramPercentile(Histogram *h, double q);
+void LockMutex(pthread_mutex_t *mutex);
+void UnlockMutex(pthread_mutex_t *mutex);
+void LockTotals(long *acquisitions, long *contentions, long *waitNanos);
+int StartMetricsServer(const char *path, SnapshotWriter writer);
+void StopMetricsServer();
+void *MetricsServer(void *arg);
+
+void HistogramAdd(Histogram *h, long value) {
+    if (value < 0) {
+        value = 0;
+    }
+    if (value >= HISTOGRAM_BUCKETS) {
+        atomic_fetch_add_explicit(&h->counts[HISTOGRAM_BUCKETS - 1], 1, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&h->counts[value], 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&h->total, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+}
+
+/* smallest value such that a fraction q of the recorded values are less than or equal to it */
+long HistogramPercentile(Histogram *h, double q) {
+    long total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    if (total == 0) {
+        return 0;
+    }
+    long rank = (long) (q * total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    long seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+        if (seen >= rank) {
+            return i;
+        }
+    }
+    return HISTOGRAM_BUCKETS - 1;
+}
+
+/* the calling thread's lock counters, added to the list the first time it takes a lock */
+static LockCounters *ThreadLockCounters() {
+    if (lockCounters == NULL) {
+        LockCounters *counters = (LockCounters *) aligned_alloc(64, 64);
+        memset(counters, 0, sizeof (LockCounters));
+        counters->next = atomic_load(&lockCounterList);
+        while (!atomic_compare_exchange_weak(&lockCounterList, &counters->next, counters)) {
+        }
+        lockCounters = counters;
+    }
+    return lockCounters;
+}
+
+/* add to a counter only its own thread writes, without a locked read-modify-write */
+static void CounterAdd(atomic_long *counter, long value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+/* pthread_mutex_lock that accounts the time spent waiting when the mutex is contended */
+void LockMutex(pthread_mutex_t *mutex) {
+    LockCounters *counters = ThreadLockCounters();
+    CounterAdd(&counters->acquisitions, 1);
+    if (pthread_mutex_trylock(mutex) == 0) {
+        TraceLockAcquired(mutex);
+        return;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_mutex_lock(mutex);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    CounterAdd(&counters->contentions, 1);
+    CounterAdd(&counters->waitNanos, (end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec));
+    TraceLockAcquired(mutex);
+}
+
+/* pthread_mutex_unlock for mutexes taken with LockMutex */
+void UnlockMutex(pthread_mutex_t *mutex) {
+    TraceLockReleased(mutex);
+    pthread_mutex_unlock(mutex);
+}
+
+/* the lock counters summed over all threads, the counts of threads still running may be a lock behind */
+void LockTotals(long *acquisitions, long *contentions, long *waitNanos) {
+    *acquisitions = *contentions = *waitNanos = 0;
+    for (LockCounters *counters = atomic_load(&lockCounterList); counters != NULL; counters = counters->next) {
+        *acquisitions += atomic_load_explicit(&counters->acquisitions, memory_order_relaxed);
+        *contentions += atomic_load_explicit(&counters->contentions, memory_order_relaxed);
+        *waitNanos += atomic_load_explicit(&counters->waitNanos, memory_order_relaxed);
+    }
+}
+
+/* listen on a Unix domain socket at path, returns FALSE if the socket can't be created */
+int StartMetricsServer(const char *path, SnapshotWriter writer) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof (addr.sun_path)) {
+        return FALSE;
+    }
+
+    metricsSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (metricsSocket < 0) {
+        return FALSE;
+    }
+
+    memset(&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(metricsSocket, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen(metricsSocket, 16) < 0) {
+        close(metricsSocket);
+        metricsSocket = -1;
+        return FALSE;
+    }
+
+    strcpy(metricsSocketPath, path);
+    metricsWriter = writer;
+    atomic_store(&metricsStopping, FALSE);
+    pthread_create(&metricsThread, NULL, MetricsServer, NULL);
+    return TRUE;
+}
+
+void StopMetricsServer() {
+    if (metricsSocket < 0) {
+        return;
+    }
+    atomic_store(&metricsStopping, TRUE);
+    pthread_join(metricsThread, NULL);
+    close(metricsSocket);
+    unlink(metricsSocketPath);
+    metricsSocket = -1;
+}
+
+/*
+ * Serve one snapshot per connection. The client may send a request line first:
+ * "prometheus" or an HTTP "GET /metrics" gets the Prometheus text format, anything else
+ * (or nothing within 100 ms) gets the compact text format.
+ */
+void *MetricsServer(void *arg) {
+    struct pollfd listener = {metricsSocket, POLLIN, 0};
+
+    while (!atomic_load(&metricsStopping)) {
+        // wake up regularly to notice StopMetricsServer
+        if (poll(&listener, 1, 200) <= 0) {
+            continue;
+        }
+        int conn = accept(metricsSocket, NULL, NULL);
+        if (conn < 0) {
+            continue;
+        }
+
+        char request[256] = {0};
+        struct pollfd client = {conn, POLLIN, 0};
+        if (poll(&client, 1, 100) > 0) {
+            ssize_t got = read(conn, request, sizeof (request) - 1);
+            if (got < 0) {
+                got = 0;
+            }
+            request[got] = '\0';
+        }
+        int http = strncmp(request, "GET ", 4) == 0;
+        int prometheus = http || strstr(request, "prom") != NULL;
+
+        FILE *out = fdopen(conn, "w");
+        if (out == NULL) {
+            close(conn);
+            continue;
+        }
+        if (http) {
+            fprintf(out, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n\r\n");
+        }
+        metricsWriter(out, prometheus);
+        fclose(out);
+    }
+
+    return NULL;
+}
@@ -1,90 +1,690 @@
+#define _GNU_SOURCE // pthread_attr_setaffinity_np
 #include "queue.c"
+#include "trace.c"
+#include "metrics.c"
+#include "affinity.c"
+#include "executor.c"
+#include "distribution.c"
+#include "queueing.c"
+#include "mailbox.c"
+#include "ingest.c"
 #include <pthread.h>
 #include <sys/time.h>
 #include <string.h>
 #include <stdio.h>
-
-#define LANDING_JOB 1
-#define LAUNCH_JOB 2
-#define ASSEMBLY_JOB 3
-#define EMERGENCY_JOB 4
+#include <errno.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <fcntl.h>
 
 #define UNIT_TIME 2
-#define LANDING_JOB_DURATION 2
-#define LAUNCH_JOB_DURATION 4
-#define ASSEMBLY_JOB_DURATION 12
-#define EMERGENCY_JOB_DURATION 2
+
+// every job type, one row each: type, name, log letter, duration in seconds, producers,
+// UNIT_TIMEs between arrival slots, jobs per arrival and arrival probability in percent.
+// --arrival and --service replace the slots and the fixed duration with other distributions.
+// A type's intake queue is <name>Queue, guarded by <name>QueueMutex. Rows are evaluated after
+// the arguments are parsed, so they may use the options.
+#define JOB_TYPES(X)                                                                   \
+    X(LANDING, landing, 'L', 2, producerCount, 1, 1, 100 - p * 100)                    \
+    X(LAUNCH, launch, 'D', 4, producerCount, 1, 1, (p / 2) * 100)                      \
+    X(ASSEMBLY, assembly, 'A', 12, producerCount, 1, 1, (p / 2) * 100)                 \
+    X(EMERGENCY, emergency, 'E', 2, 1, emergencyFrequency, emergencyBatch, 100)
+
+// LANDING_JOB = 1, LAUNCH_JOB = 2, ..., arrays indexed by type have JOB_TYPE_END entries
+#define JOB_TYPE_ENUM(TYPE, name, ...) TYPE##_JOB,
+enum
+{
+    NO_JOB,
+    JOB_TYPES(JOB_TYPE_ENUM) JOB_TYPE_END
+};
+
+// the bit of a job type in a pad's capabilities
+#define TYPE_MASK(type) (1u << (type))
+
+// LANDING_JOB_DURATION, LAUNCH_JOB_DURATION, ...
+#define JOB_DURATION_ENUM(TYPE, name, letter, duration, ...) TYPE##_JOB_DURATION = duration,
+enum
+{
+    JOB_TYPES(JOB_DURATION_ENUM)
+};
+
+// what a pad is sleeping on
+#define SEGMENT_NONE 0
+#define SEGMENT_IDLE 1
+#define SEGMENT_JOB 2
+#define SEGMENT_EMERGENCY 3
+#define SEGMENT_OUTAGE 4
+
+// events that end a PadSleep early
+#define WAKE_ON_EMERGENCY 1
+#define WAKE_ON_SHUTDOWN 2
+#define WAKE_ON_READY 4 // pull dispatch: a job the idle pad can serve is waiting in an intake queue
+#define WAKE_ON_DOWN 8  // the pad went down
+#define WAKE_ON_UP 16   // the pad is up again
+#define WAKE_ON_QUEUED 32 // push dispatch: the tower gave the idle pad a job
+
+// what a producer does when its intake queue is full
+#define OVERLOAD_DROP_NEWEST 0 // the new job is dropped
+#define OVERLOAD_DROP_OLDEST 1 // the job at the head of the queue is dropped to make room
+#define OVERLOAD_BLOCK 2       // the producer waits until there is room, its arrivals stop meanwhile
+#define OVERLOAD_REJECT 3      // like drop newest, and jobs are also rejected when their predicted wait is too long
+
+#define BLOCK_RETRY_MILLIS 10
+
+// stress mode: producers wake every STRESS_TICK_MILLIS, at most MAX_STRESS_STEPS doublings of the offered load
+#define STRESS_TICK_MILLIS 1
+#define MAX_STRESS_STEPS 24
+
+// landings a tower can hand to other towers' mailboxes before they take them
+#define MAILBOX_CAPACITY 1024
+#define LOG_BUFFER 65536 // bytes of log lines a shard collects before it appends them to log.txt at once
+#define PAD_COUNTERS (JOB_TYPE_END + 3) // a pad's ms busy per job type, ms idle, ms down and jobs served
+#define SCALE_CHECK_MILLIS 100 // how often a tower with --autoscale looks at its backlog
+#define DRAIN_POLL_MILLIS 10    // how often --drain checks whether the system is empty
+#define DISPLAY_CHANGES 1000 // job IDs the delta display prints per queue and second, more are only counted
+
+// checkpoint file header
+#define CHECKPOINT_MAGIC 0x4b435053 // "SPCK"
+#define CHECKPOINT_VERSION 3
 
 int simulationTime = 120; // simulation time
 time_t deadline = 0;      // deadline
 time_t simulationStartTime = 0;
+long startMillis = 0;        // ms since the epoch when the simulated clock was at 0, what CurrentMillis() counts from
 int n = 30;                  // logging queues start time
 int seed = 10;               // seed for randomness
 int emergencyFrequency = 40; // frequency of emergency
 float p = 0.2;               // probability of a ground job (launch & assembly)
-
-void *LandingJob(void *arg);
-void *LaunchJob(void *arg);
-void *EmergencyJob(void *arg);
-void *AssemblyJob(void *arg);
+int padCount = 2;            // number of pads
+int emergencyBatch = 2;      // emergency jobs created at every emergency
+int finishInFlight = FALSE;  // whether pads finish the job they are serving when the simulation ends
+int drain = FALSE;           // whether to stop the arrivals at the deadline and run until every job is done
+atomic_int shuttingDown;     // set once by Shutdown()
+int sampleInterval = 0;      // milliseconds between queue samples, 0 disables the sampler
+int padWindow = 0;           // milliseconds per window of pad accounting, 0 disables the windows
+int sampleCapacity = 4096;   // samples kept in the ring buffer
+char *metricsPath = NULL;    // Unix socket the metrics snapshot is served on, NULL disables it
+char *ingestName = NULL;     // shared memory ring external processes submit jobs to, NULL disables it
+int ingestCapacity = 65536;  // jobs the ingestion ring holds
+int quiet = FALSE;           // whether PrintCurrentQueues is disabled
+int deltaDisplay = FALSE;    // whether PrintCurrentQueues prints the changes of the queues instead of their contents
+int summaryEvery = 10;       // seconds between the size and duration summaries of the delta display
+char *tracePath = NULL;      // trace-event JSON file written at exit, NULL disables tracing
+CpuList towerCpus;           // CPUs to pin the threads of each role to, empty for no pinning
+CpuList padCpus;
+CpuList producerCpus;
+int fifoPriority = 0;        // SCHED_FIFO priority of the pinned threads, 0 keeps the default policy
+int producerCount = 1;       // landing, launch and assembly producers of each type
+int workerCount = 0;         // worker threads running pads and producers as tasks, 0 for a thread each
+char *checkpointPath = NULL; // file the simulation state is written to at the end, NULL disables it
+char *restorePath = NULL;    // checkpoint file the simulation starts from, NULL starts empty
+long shutdownMillis = 0;     // ms since start when Shutdown() was called
+long runStartMillis = 0;     // ms since start when this run started, the checkpoint's clock after --restore
+int estimate = FALSE;        // whether to print the queueing model's estimate instead of simulating
+int estimateCheck = FALSE;   // whether to also simulate and compare the estimate with the simulation
+int queueLimit = 1000;       // capacity of every intake and pad queue
+int idleMillis = UNIT_TIME * 1000; // how long an idle pad sleeps before it checks its queue again
+int stress = FALSE;          // whether to ramp zero-duration jobs up to the tower's capacity instead of simulating
+long stressStart = 1000;     // offered jobs per second of the first stress step, doubled every step
+int stressStepMillis = 1000; // length of a stress step
+int towerCount = 1;          // control towers, each dispatching its own intake queues to its own pads
+long migrateMargin = 2000;   // ms a tower's pads must be behind another tower's before it hands landings over
+int pullDispatch = FALSE;    // whether free pads take their next job from the intake queues instead of the tower pushing it
+int compareDispatch = FALSE; // whether to run the simulation with push and with pull dispatch and compare them
+int summaryFd = -1;          // pipe a child of --dispatch compare writes its DispatchSummary to
+double outageUp = 0;         // --outages: mean seconds a pad is up between random outages, 0 for none
+double outageDown = 0;       // --outages: mean seconds a random outage lasts
+int scaleMin = 0;            // --autoscale: pads kept active, 0 when the pad count is fixed
+int scaleMax = 0;            // --autoscale: pads there are, the ones not needed are parked
+long scaleUp = 3000;         // ms of backlog per active pad above which a tower activates a parked pad
+long scaleDown = 500;        // ms of backlog per active pad below which it parks one
+long scaleHold = 2000;       // ms a tower leaves its pad count alone after changing it
+int scaleOnWait = FALSE;     // scale on the longest predicted wait instead of the backlog per pad
+
+typedef struct
+{
+    int index;
+    char name[12];
+    char threadName[16];
+    Queue *queue;
+    Queue *emergencyQueue;
+    pthread_mutex_t queueMutex;
+    pthread_mutex_t emergencyQueueMutex;
+    pthread_cond_t emergencyCond; // signalled by the control tower when the pad gets an emergency job
+    long busyUntil;               // ms since start when the current job ends, protected by emergencyQueueMutex
+    int busyEmergency;            // whether the current job is an emergency job
+    atomic_long busyMillis;       // time spent serving jobs, for the metrics
+    atomic_long jobsServed;       // jobs completed on this pad, for the metrics
+    // the pad's accounting, only the pad adds to it
+    atomic_long typeMillis[JOB_TYPE_END]; // time spent serving each job type, emergencies included
+    atomic_long typeJobs[JOB_TYPE_END];   // jobs of each type completed
+    atomic_long idleMillis;               // time without work
+    atomic_long downMillis;               // time in an outage or parked
+    atomic_int accountState;              // what the current segment is accounted as, a PadCounters index, -1 for none
+    atomic_long accountSince;             // ms since start when the current segment started
+    atomic_uint accountSequence;          // odd while the pad updates its accounting, readers retry then
+    atomic_int waiting;           // the pad is idle until a job it can serve arrives, or the tower gives it one
+    unsigned capabilities;        // TYPE_MASK of every job type the pad can serve
+    long projectedFinish;         // ms since start when the work the tower gave it should be done, only the tower writes it
+    atomic_int down;              // in an outage, the tower does not give it work
+    int outages;                  // outage windows the pad is in, only the tower writes it
+    atomic_long stranded;         // jobs it handed back to the tower when it went down
+    int parked;                   // taken out of service by --autoscale, only the tower writes it
+    int segment;                  // what the pad is sleeping on, only used by the pad itself
+    long segmentStart;            // ms since start
+    long segmentLength;           // ms
+    long traceStart;
+    Job current;                  // copy of the job being served
+    Task task;                    // the pad as a task in the M:N mode
+} Pad;
+
+typedef struct
+{
+    int type;
+    uint64_t rng;     // state of the producer's own random number generator
+    Sampler arrivals; // interarrival times, if the type has an arrival distribution
+    Sampler services; // service times
+    Job blockedJob;   // with OVERLOAD_BLOCK, the job waiting for room in the intake queue
+    int blocked;      // jobs of the current arrival not admitted yet, blockedJob is the first one
+    long blockedSince;
+    double owed;      // stress mode: jobs the producer is behind its share of the offered load
+    long lastStep;    // stress mode: ms since start of its last step
+    Task task;        // the producer as a task in the M:N mode
+} Producer;
+
+// the pads of a shard that can serve a job type, a min-heap on their projectedFinish. A pad is in the
+// index of every type it serves, and its projectedFinish only grows, so keys[] may lag behind: a heap
+// entry is fixed when it reaches the top, everything below has a key at most as large.
+typedef struct
+{
+    Pad **pads;
+    long *keys; // projectedFinish of pads[i] when it was last put in place
+    int count;
+} PadIndex;
+
+// a control tower with the intake queues and pads it owns. Jobs are hashed to a shard by their ID, and a
+// tower whose pads fall behind hands landings to the mailbox of a tower whose pads are idle.
+typedef struct
+{
+    int index;
+    char threadName[16];
+    Queue *queues[JOB_TYPE_END];              // intake queues by type, shard 0's are landingQueue, launchQueue, ...
+    pthread_mutex_t *mutexes[JOB_TYPE_END];   // of the intake queues
+    pthread_mutex_t ownMutexes[JOB_TYPE_END]; // the intake mutexes of the shards after the first
+    Pad **pads;                               // pads shard, shard + towerCount, shard + 2 * towerCount, ...
+    int padCount;
+    PadIndex capable[JOB_TYPE_END];           // the pads that can serve each type
+    Mailbox *mailbox;                         // landings migrated from other shards and jobs stranded on its pads
+                                              // that went down, only this tower pops
+    long nextOutageEvent;                     // ms since start when one of its pads goes down or up next
+    int activePads;                           // pads that are not parked
+    int minPads;                              // pads --autoscale keeps active
+    long nextScaleCheck;                      // ms since start
+    long lastScale;                           // ms since start when it last activated or parked a pad
+    atomic_long load;                         // published by the tower, see ShardLoad
+    atomic_long migratedOut;                  // landings handed to other shards
+    atomic_long migratedIn;
+    pthread_mutex_t logMutex;                 // of the log buffer, only taken by the shard's pads
+    char logName[16];                         // of logMutex in the trace
+    char *log;                                // log lines of its completed jobs not in log.txt yet
+    int logLength;
+} Shard;
+
+// a window in which a pad is down, from --outage or drawn for --outages
+typedef struct
+{
+    Pad *pad;
+    long start; // ms since start
+    long end;
+    int state;     // 0 before the window, 1 in it, 2 after it
+    long stranded; // jobs the pad handed back during the window, counted from the pad's total when it ends
+} Outage;
+
+// what a run of --dispatch compare reports to the parent process
+typedef struct
+{
+    long completed[JOB_TYPE_END];
+    long waitMillis[JOB_TYPE_END];
+    long sojournMillis[JOB_TYPE_END];
+    long turnaround[3]; // p50, p90 and p99 in seconds
+} DispatchSummary;
+
+void InitJobTypes();
+void *ProducerThread(void *arg);
+long ProducerStep(Producer *producer);
+void Produce(Producer *producer);
+void StressProduce(Producer *producer);
+void RunStress();
+int Admit(Job j);
+long NextArrivalDelay(Producer *producer);
+int DispatchJob(Queue *from, Queue *to);
+long PredictedWait(Shard *shard, int type);
+Shard *ShardOf(Job j);
+long ShardLoad(Shard *shard);
+int DispatchLanding(Shard *shard);
+int PadCanServe(Pad *pad, int type);
+int HasReadyJob(Pad *pad);
+int PullJob(Pad *pad);
+void WakeReadyPad(Shard *shard, int type);
+int CompareDispatch();
+void PrintTowerReport();
+void PrintOverloadReport();
 void *ControlTower(void *arg);
-void *PadA(void *arg);
-void *PadB(void *arg);
-void *WriteLog(Job j, char pad);
+void *LaunchPad(void *arg);
+int PadStep(Pad *pad);
+int PadStartSegment(Pad *pad);
+void PadEndSegment(Pad *pad, long elapsed);
+int PadWakeEvents(Pad *pad);
+void WakePad(Pad *pad);
+long PadTask(Task *task);
+long ProducerTask(Task *task);
+void *WriteLog(Job j, Pad *pad);
+void FlushLog(Shard *shard);
 void *PrintCurrentQueues(void *arg);
 void PrintQueue(Queue *queue);
+pthread_mutex_t *QueueMutex(int k);
+void PrintQueueChanges(int current_time);
+void PrintQueueSummary(int current_time);
+void *QueueSampler(void *arg);
+void DumpSamples();
+void PadAccount(Pad *pad, int next);
+void PadCounters(Pad *pad, long now, long *counters);
+void *PadWindowSampler(void *arg);
+void DumpPadWindows();
+void PrintPadReport();
+void WriteMetrics(FILE *out, int prometheus);
+void BuildQueueModel(QueueClass *classes);
+void PrintEstimate(QueueClass *classes);
+void PrintEstimateCheck(QueueClass *classes);
+int SleepMillis(int milliseconds);
 char GetType(int type);
-
-Queue *landingQueue;
-Queue *launchQueue;
-Queue *assemblyQueue;
-Queue *emergencyQueue;
-Queue *padAEmergencyQueue;
-Queue *padBEmergencyQueue;
-Queue *padAQueue;
-Queue *padBQueue;
+const char *GetTypeName(int type);
+Job CreateJob(int type, int duration);
+Job Dispatched(Job j);
+uint64_t NextJobID();
+FILE *OpenCheckpoint(const char *path);
+int LoadCheckpoint(FILE *fp);
+int WriteCheckpoint(const char *path);
+int PadSleep(Pad *pad, int milliseconds, int wakeOn);
+int SimulationRunning();
+int ArrivalsOpen();
+void Drain();
+void IngestJobs();
+void PrintIngestReport();
+void PrintBacklogReport();
+void Shutdown();
+long CurrentMillis();
+Pad *EarliestAvailablePad(Shard *shard);
+Pad *LeastLoadedPad(Shard *shard, int type);
+Pad *NextPadFor(Shard *shard, int type);
+void PadIndexAdd(PadIndex *index, Pad *pad);
+int DispatchToPad(Queue *from, Pad *pad);
+void Assigned(Pad *pad, long duration);
+int SetPadCapabilities(const char *spec);
+int AddOutage(Pad *pad, long start, long end);
+int ParseOutage(const char *spec);
+void ProcessOutages(Shard *shard, long now);
+void PadDown(Pad *pad);
+void PadUp(Shard *shard, Pad *pad);
+int HandOver(Pad *pad);
+void DrainMailbox(Shard *shard);
+int Redispatch(Shard *shard, Job j);
+void PrintOutageReport();
+int CoversAllTypes(Shard *shard, Pad *except);
+void Autoscale(Shard *shard, long now);
+void SetParked(Shard *shard, Pad *pad, int parked);
+void PrintScaleReport();
+
+// the intake queues, landingQueue, launchQueue, ...
+#define JOB_TYPE_QUEUE(TYPE, name, ...) Queue *name##Queue;
+JOB_TYPES(JOB_TYPE_QUEUE)
+
+// pads[0] is padA, pads[1] is padB, ...
+Pad *pads;
+
+// the control towers, shards[0] owns the intake queues above
+Shard *shards;
+
+// the pad outage windows, and the jobs completed and their summed turnaround in ms per second of the
+// simulation, to compare the throughput before, during and after them
+Outage *outages;
+int outageCount;
+atomic_long *timelineJobs;
+atomic_long *timelineTurnaround;
+int timelineSeconds;
+
+// pads active over all towers with --autoscale, and per active pad count the ms spent at it, the jobs
+// completed at it and their summed turnaround in ms
+pthread_mutex_t scaleMutex = PTHREAD_MUTEX_INITIALIZER;
+atomic_int activePads;
+long scaleSince;
+long *scaleMillis;
+atomic_long *scaleJobs;
+atomic_long *scaleTurnaround;
+atomic_long scaleUps, scaleDowns;
+
+// the producers of every job type, grouped by type
+Producer *producers;
+int allProducerCount;
+
+// every queue of the simulation, in the order PrintCurrentQueues prints them
+Queue **allQueues;
+char (*allQueueNames)[24];
+int allQueueCount;
+
+// journals the delta display swaps with the ones the queues record into, one per queue in allQueues
+QueueJournal **spareJournals;
+
+// ring buffer of queue samples, sampleTimes[k] belongs to the k-th row of sampleSizes and sampleDurations
+long *sampleTimes;
+int *sampleSizes;
+int *sampleDurations;
+long sampleCount; // number of samples taken so far, the oldest ones are overwritten
+
+// ring buffer of pad accounting snapshots, windowCounters holds PAD_COUNTERS values per pad for every row
+// of windowTimes, with the same capacity as the queue samples
+long *windowTimes;
+long *windowCounters;
+long windowCount;
+
+// job IDs are the creating thread's tag in the high 16 bits and its own sequence number in the low 48 bits
+atomic_ulong nextThreadTag;
+__thread uint64_t jobThreadTag;
+__thread uint64_t jobSequence;
+
+// completed jobs per type and their turnaround times in seconds, for the metrics
+atomic_long completedJobs[JOB_TYPE_END];
+Histogram turnaroundHistogram;
+
+// summed waits until service starts and sojourn times in milliseconds per type, to check the estimate
+atomic_long waitMillis[JOB_TYPE_END];
+atomic_long sojournMillis[JOB_TYPE_END];
+
+// what the overload policies did per type
+atomic_long droppedJobs[JOB_TYPE_END];
+atomic_long rejectedJobs[JOB_TYPE_END];
+atomic_long blockedJobs[JOB_TYPE_END];
+atomic_long blockedMillis[JOB_TYPE_END];
+
+// jobs admitted and not completed or dropped yet, wherever they are: intake, pad or emergency queue, mailbox or
+// being served. With --drain, arrivals stop at the deadline and the run ends once it is 0.
+atomic_long jobsInSystem;
+
+// the ingestion ring, the first tower takes its jobs, and how many it admitted and refused for a bad type
+IngestRing ingestRing;
+atomic_long ingestedJobs;
+atomic_long ingestInvalid;
+atomic_int arrivalsStopped;
+long drainedJobs;
+long drainMillis;
+
+// stress mode: the offered load and the jobs created so far, and the dispatch latency of every step in ms
+atomic_long stressRate;
+atomic_long stressOffered;
+atomic_int stressStep;
+Histogram stressLatency[MAX_STRESS_STEPS];
 
 // create a mutex for each queue
-pthread_mutex_t landingQueueMutex;
-pthread_mutex_t launchQueueMutex;
-pthread_mutex_t assemblyQueueMutex;
-pthread_mutex_t emergencyQueueMutex;
-pthread_mutex_t padAEmergencyQueueMutex;
-pthread_mutex_t padBEmergencyQueueMutex;
-pthread_mutex_t padAQueueMutex;
-pthread_mutex_t padBQueueMutex;
-
-// create log file mutex
-pthread_mutex_t logFileMutex;
-
-// pthread sleeper function
+#define JOB_TYPE_MUTEX(TYPE, name, ...) pthread_mutex_t name##QueueMutex;
+JOB_TYPES(JOB_TYPE_MUTEX)
+
+typedef struct
+{
+    char letter;
+    const char *name;
+    int duration;
+    Queue **queue;            // intake queue
+    pthread_mutex_t *mutex;   // of the intake queue
+    const char *queueName;    // of the intake queue in the trace
+    const char *enqueueEvent; // trace instant of an arrival
+    const char *producerName; // trace thread of a producer
+    int producers;            // the arrival parameters, set by InitJobTypes
+    int period;
+    int batch;
+    double percent;
+    Distribution arrival;     // interarrival times, DIST_NONE for the slots of the table
+    Distribution service;     // service times, the table's fixed duration by default
+    int overload;             // OVERLOAD_ policy of the intake queue
+    long rejectAbove;         // with OVERLOAD_REJECT, the longest predicted wait admitted, ms
+} JobType;
+
+// the JOB_TYPES table by type, so the per-type paths are lookups instead of branches
+#define JOB_TYPE_ROW(TYPE, name, letter, duration, ...) \
+    [TYPE##_JOB] = {letter, #name, duration, &name##Queue, &name##QueueMutex, #name "Queue", "enqueue " #name, #name " producer"},
+JobType jobTypes[JOB_TYPE_END] = {[NO_JOB] = {'U', "unknown"}, JOB_TYPES(JOB_TYPE_ROW)};
+
+// log.txt opened for appending, every shard adds a batch of lines with one write
+int logFd = -1;
+
+// broadcast when the simulation ends to wake every sleeping thread
+pthread_mutex_t shutdownMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t shutdownCond = PTHREAD_COND_INITIALIZER;
+
+// pthread sleeper function, returns early when the simulation is shut down
 int pthread_sleep(int seconds)
 {
-    pthread_mutex_t mutex;
-    pthread_cond_t conditionvar;
+    return SleepMillis(seconds * 1000);
+}
+
+// millisecond pthread sleeper, returns early when the simulation is shut down
+int SleepMillis(int milliseconds)
+{
     struct timespec timetoexpire;
-    if (pthread_mutex_init(&mutex, NULL))
+    struct timeval tp;
+    // When to expire is an absolute time, so get the current time and add it to our delay time
+    gettimeofday(&tp, NULL);
+    long nsec = tp.tv_usec * 1000L + (milliseconds % 1000) * 1000000L;
+    timetoexpire.tv_sec = tp.tv_sec + milliseconds / 1000 + nsec / 1000000000L;
+    timetoexpire.tv_nsec = nsec % 1000000000L;
+
+    pthread_mutex_lock(&shutdownMutex);
+    int res = 0;
+    while (!shuttingDown && res != ETIMEDOUT)
     {
-        return -1;
+        res = pthread_cond_timedwait(&shutdownCond, &shutdownMutex, &timetoexpire);
     }
-    if (pthread_cond_init(&conditionvar, NULL))
+    pthread_mutex_unlock(&shutdownMutex);
+
+    if (res == ETIMEDOUT)
     {
-        return -1;
+        RecordSleepLateness(&timetoexpire);
+    }
+
+    // Upon successful completion, a value of zero shall be returned
+    return res;
+}
+
+// whether the simulation is still running
+int SimulationRunning()
+{
+    return !atomic_load(&shuttingDown);
+}
+
+// admit a batch of jobs from the ingestion ring to their intake queues, called by the first tower. A job is
+// stamped like a producer's. It stays in the ring while its intake queue is full, so a full simulation
+// pushes back on the clients instead of dropping their jobs. The lock of a type is kept over a run of jobs
+// of that type.
+void IngestJobs()
+{
+    Mailbox *ring = ingestRing.mailbox;
+    pthread_mutex_t *locked = NULL;
+    unsigned ready = 0; // types with new jobs, to wake pull dispatch pads
+    Job *j;
+    for (int taken = 0; taken < INGEST_BATCH && (j = MailboxPeek(ring)) != NULL; taken++)
+    {
+        // clients name the type by its log letter
+        int type = LANDING_JOB;
+        while (type < JOB_TYPE_END && jobTypes[type].letter != j->type)
+        {
+            type++;
+        }
+        if (type == JOB_TYPE_END || j->duration < 0)
+        {
+            MailboxPop(ring, j);
+            atomic_fetch_add(&ingestInvalid, 1);
+            continue;
+        }
+
+        Job job = CreateJob(type, j->duration);
+        Shard *shard = ShardOf(job);
+        if (locked != shard->mutexes[job.type])
+        {
+            if (locked != NULL)
+            {
+                UnlockMutex(locked);
+            }
+            locked = shard->mutexes[job.type];
+            LockMutex(locked);
+        }
+        if (!Enqueue(shard->queues[job.type], job))
+        {
+            break;
+        }
+        MailboxPop(ring, j);
+        atomic_fetch_add(&jobsInSystem, 1);
+        atomic_fetch_add(&ingestedJobs, 1);
+        ready |= TYPE_MASK(job.type);
+    }
+    if (locked != NULL)
+    {
+        UnlockMutex(locked);
+    }
+
+    for (int type = LANDING_JOB; pullDispatch && type < EMERGENCY_JOB; type++)
+    {
+        for (int s = 0; (ready & TYPE_MASK(type)) && s < towerCount; s++)
+        {
+            WakeReadyPad(&shards[s], type);
+        }
+    }
+}
+
+// what came in through the ingestion ring, and what was left in it
+void PrintIngestReport()
+{
+    long left = 0;
+    Job j;
+    while (MailboxPop(ingestRing.mailbox, &j))
+    {
+        left++;
+    }
+    printf("Ingested %ld jobs through %s, %ld with an invalid type or duration, %ld left in the ring\n", atomic_load(&ingestedJobs), ingestRing.name,
+           atomic_load(&ingestInvalid), left);
+}
+
+// whether producers still create jobs, --drain stops them before the simulation ends
+int ArrivalsOpen()
+{
+    return SimulationRunning() && !atomic_load(&arrivalsStopped);
+}
+
+// --drain: stop the arrivals and wait until the jobs left have all been served
+void Drain()
+{
+    atomic_store(&arrivalsStopped, TRUE);
+    if (ingestName != NULL)
+    {
+        IngestClose(&ingestRing);
+    }
+    long start = CurrentMillis();
+    drainedJobs = atomic_load(&jobsInSystem);
+    while (atomic_load(&jobsInSystem) > 0)
+    {
+        SleepMillis(DRAIN_POLL_MILLIS);
     }
+    drainMillis = CurrentMillis() - start;
+}
+
+// end the simulation and wake up every sleeping thread
+void Shutdown()
+{
+    pthread_mutex_lock(&shutdownMutex);
+    shutdownMillis = CurrentMillis();
+    atomic_store(&shuttingDown, TRUE);
+    pthread_cond_broadcast(&shutdownCond);
+    pthread_mutex_unlock(&shutdownMutex);
+
+    // pads sleep on their own condition variables
+    for (int i = 0; i < padCount; i++)
+    {
+        LockMutex(&pads[i].emergencyQueueMutex);
+        pthread_cond_broadcast(&pads[i].emergencyCond);
+        UnlockMutex(&pads[i].emergencyQueueMutex);
+    }
+}
+
+// ms since the epoch
+static long EpochMillis()
+{
     struct timeval tp;
-    // When to expire is an absolute time, so get the current time and add it to our delay time
     gettimeofday(&tp, NULL);
-    timetoexpire.tv_sec = tp.tv_sec + seconds;
-    timetoexpire.tv_nsec = tp.tv_usec * 1000;
+    return tp.tv_sec * 1000L + tp.tv_usec / 1000;
+}
 
-    pthread_mutex_lock(&mutex);
-    int res = pthread_cond_timedwait(&conditionvar, &mutex, &timetoexpire);
-    pthread_mutex_unlock(&mutex);
-    pthread_mutex_destroy(&mutex);
-    pthread_cond_destroy(&conditionvar);
+// milliseconds passed since the start of the simulation
+long CurrentMillis()
+{
+    return EpochMillis() - startMillis;
+}
 
-    // Upon successful completion, a value of zero shall be returned
-    return res;
+// interruptible pad sleeper, wakes up early when an emergency job arrives at the pad (WAKE_ON_EMERGENCY),
+// when the simulation is shut down (WAKE_ON_SHUTDOWN), when a job the pad can pull arrives (WAKE_ON_READY)
+// or is given to the pad (WAKE_ON_QUEUED), or when the pad goes down (WAKE_ON_DOWN) or up (WAKE_ON_UP), returns the
+// number of milliseconds actually slept
+int PadSleep(Pad *pad, int milliseconds, int wakeOn)
+{
+    struct timeval start, end;
+    struct timespec timetoexpire;
+    gettimeofday(&start, NULL);
+
+    long nsec = start.tv_usec * 1000L + (milliseconds % 1000) * 1000000L;
+    timetoexpire.tv_sec = start.tv_sec + milliseconds / 1000 + nsec / 1000000000L;
+    timetoexpire.tv_nsec = nsec % 1000000000L;
+
+    pthread_mutex_lock(&pad->emergencyQueueMutex);
+    int res = 0;
+    while (res != ETIMEDOUT)
+    {
+        if ((wakeOn & WAKE_ON_EMERGENCY) && !isEmpty(pad->emergencyQueue))
+        {
+            break;
+        }
+        if ((wakeOn & WAKE_ON_SHUTDOWN) && shuttingDown)
+        {
+            break;
+        }
+        if ((wakeOn & WAKE_ON_READY) && HasReadyJob(pad))
+        {
+            break;
+        }
+        if ((wakeOn & WAKE_ON_QUEUED) && QueueSize(pad->queue) > 0)
+        {
+            break;
+        }
+        if ((wakeOn & WAKE_ON_DOWN) && atomic_load(&pad->down))
+        {
+            break;
+        }
+        if ((wakeOn & WAKE_ON_UP) && !atomic_load(&pad->down))
+        {
+            break;
+        }
+        res = pthread_cond_timedwait(&pad->emergencyCond, &pad->emergencyQueueMutex, &timetoexpire);
+    }
+    pthread_mutex_unlock(&pad->emergencyQueueMutex);
+
+    if (res == ETIMEDOUT)
+    {
+        RecordSleepLateness(&timetoexpire);
+    }
+
+    gettimeofday(&end, NULL);
+    int slept = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_usec - start.tv_usec) / 1000;
+    if (res == ETIMEDOUT || slept > milliseconds)
+    {
+        slept = milliseconds;
+    }
+    return slept;
 }
 
 int main(int argc, char **argv)
@@ -92,6 +692,62 @@ int main(int argc, char **argv)
     // -p (float) => sets p
     // -t (int) => simulation time in seconds
     // -s (int) => change the random seed
+    // --sample (int) => sample every queue each given milliseconds, dumped to samples.txt at exit
+    // --sample-capacity (int) => number of samples kept, older ones are overwritten
+    // --pad-window (int) => account the pads' time per window of the given milliseconds, dumped to pad_windows.txt
+    //                       at exit (keeps --sample-capacity windows)
+    // --metrics (path) => serve a metrics snapshot on the given Unix socket
+    // --quiet => don't print the queues
+    // --display (mode) => full: print every queue's jobs each second (default), delta: print the jobs enqueued and
+    //                     dequeued since the last second and a summary of the sizes and durations now and then
+    // --summary-every (int) => seconds between the summaries of --display delta, 10 by default
+    // --trace (path) => record thread, lock and pad activity as trace-event JSON
+    // --cpu-tower, --cpu-pads, --cpu-producers (list) => pin the threads to CPUs, e.g. 0,2-3 (used round robin)
+    // --fifo (int) => run the pinned threads under SCHED_FIFO with the given priority
+    // --jitter => report how much later than requested the timed sleeps woke up
+    // --workers (int) => run the pads and producers as tasks on this many worker threads (M:N mode)
+    // --producers (int) => number of landing, launch and assembly producers of each type
+    // --checkpoint (path) => write the queues, in-flight jobs, random states and clock to the file at the end
+    // --restore (path) => start from a checkpoint instead of empty queues, uses its pad and producer counts
+    // --arrival (type=spec) => arrivals of a job type, poisson:<per s>, deterministic:<s>,
+    //                          mmpp:<per s>,<per s>,<s in state 1>,<s in state 2> or empirical:<file of s>
+    // --service (type=spec) => service times of a job type, fixed:<s>, exponential:<mean s>,
+    //                          lognormal:<mean s>,<sigma> or empirical:<file of s>
+    // --estimate => print the utilization, throughput and waits predicted by a queueing model and exit
+    // --estimate-check => print the estimate, then simulate (best with a short -t) and report its error
+    // --queue-limit (int) => capacity of the intake and pad queues, 1000 by default
+    // --overload (type=policy) => what producers do when an intake queue is full: drop-newest (default),
+    //                             drop-oldest, block or reject:<s> (also reject jobs whose predicted wait exceeds s)
+    // --finish-inflight => pads finish the job they are serving at the deadline instead of abandoning it
+    // --drain => no arrivals after the deadline, the run goes on until every job is done and reports how long that took
+    // --stress => offer zero-duration jobs as fast as the producers can, doubling the load every step
+    //             until dispatch latency or drops blow up, and report the knee
+    // --stress-start (int) => offered jobs per second of the first stress step, 1000 by default
+    // --stress-step (int) => milliseconds per stress step, 1000 by default
+    // --towers (int) => control towers, each with its own intake queues and every towers-th pad
+    // --migrate-margin (int) => ms a tower's least loaded pad must be behind another tower's before
+    //                           it hands landings over, 2000 by default
+    // --dispatch (mode) => push: the tower hands jobs to pad queues early (default), pull: free pads take the
+    //                      next job they may serve from the intake queues, compare: simulate both and compare
+    // --pad-caps (pad=letters) => the job types a pad serves by their log letters, e.g. C=LE for landings and
+    //                             emergencies only. By default a shard's 1st, 3rd, ... pads serve all but
+    //                             assembly jobs and its 2nd, 4th, ... pads all but launches
+    // --outage (pad=start+length) => take the pad down at start seconds for length seconds, the jobs queued on it
+    //                               are dispatched to the pads that are up
+    // --outages (up,down) => random outages of every pad, exponential times up and down with the means in seconds
+    // --autoscale (min,max) => max pads, of which the towers keep between min and max active by their backlog
+    // --scale-up, --scale-down (int) => ms of backlog per active pad above which a pad is activated, below which
+    //                                   one is parked (3000 and 500 by default)
+    // --scale-hold (int) => ms a tower keeps its pad count after changing it, 2000 by default
+    // --scale-signal (signal) => backlog: the queued ms per active pad (default), wait: the longest predicted wait
+    // --ingest (name[,capacity]) => take jobs from external processes through a shared memory ring of the given
+    //                              name, 65536 jobs by default (see ingest_client.c)
+    // --pads (int) => number of pads
+    // --emergency-batch (int) => emergency jobs created at every emergency
+    const char **padCapabilitySpecs = (const char **)malloc(argc * sizeof(char *));
+    int padCapabilitySpecCount = 0;
+    const char **outageSpecs = (const char **)malloc(argc * sizeof(char *));
+    int outageSpecCount = 0;
     for (int i = 1; i < argc; i++)
     {
         if (!strcmp(argv[i], "-p"))
@@ -110,516 +766,3049 @@ int main(int argc, char **argv)
         {
             n = atoi(argv[++i]);
         }
+        else if (!strcmp(argv[i], "--pads"))
+        {
+            padCount = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--emergency-batch"))
+        {
+            emergencyBatch = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--finish-inflight"))
+        {
+            finishInFlight = TRUE;
+        }
+        else if (!strcmp(argv[i], "--display"))
+        {
+            i++;
+            if (!strcmp(argv[i], "delta") || !strcmp(argv[i], "full"))
+            {
+                deltaDisplay = !strcmp(argv[i], "delta");
+            }
+            else
+            {
+                fprintf(stderr, "invalid --display: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--summary-every"))
+        {
+            summaryEvery = atoi(argv[++i]);
+            if (summaryEvery < 1)
+            {
+                summaryEvery = 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--drain"))
+        {
+            drain = TRUE;
+        }
+        else if (!strcmp(argv[i], "--metrics"))
+        {
+            metricsPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--trace"))
+        {
+            tracePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--cpu-tower") || !strcmp(argv[i], "--cpu-pads") || !strcmp(argv[i], "--cpu-producers"))
+        {
+            CpuList *list = !strcmp(argv[i], "--cpu-tower") ? &towerCpus : !strcmp(argv[i], "--cpu-pads") ? &padCpus : &producerCpus;
+            if (!ParseCpuList(argv[i + 1], list))
+            {
+                fprintf(stderr, "invalid cpu list for %s: %s\n", argv[i], argv[i + 1]);
+                return 1;
+            }
+            i++;
+        }
+        else if (!strcmp(argv[i], "--workers"))
+        {
+            workerCount = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--producers"))
+        {
+            producerCount = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--checkpoint"))
+        {
+            checkpointPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--restore"))
+        {
+            restorePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--arrival") || !strcmp(argv[i], "--service"))
+        {
+            int arrival = !strcmp(argv[i], "--arrival");
+            char *spec = argv[++i];
+            char *equals = strchr(spec, '=');
+            int type = NO_JOB;
+            for (int k = LANDING_JOB; equals != NULL && k < JOB_TYPE_END; k++)
+            {
+                if (strlen(jobTypes[k].name) == (size_t)(equals - spec) && !strncmp(spec, jobTypes[k].name, equals - spec))
+                {
+                    type = k;
+                }
+            }
+            if (type == NO_JOB || !ParseDistribution(equals + 1, arrival ? &jobTypes[type].arrival : &jobTypes[type].service, arrival))
+            {
+                fprintf(stderr, "invalid %s: %s\n", argv[i - 1], spec);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--estimate"))
+        {
+            estimate = TRUE;
+        }
+        else if (!strcmp(argv[i], "--estimate-check"))
+        {
+            estimate = TRUE;
+            estimateCheck = TRUE;
+        }
+        else if (!strcmp(argv[i], "--queue-limit"))
+        {
+            queueLimit = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--overload"))
+        {
+            char *spec = argv[++i];
+            char *equals = strchr(spec, '=');
+            int type = NO_JOB;
+            for (int k = LANDING_JOB; equals != NULL && k < JOB_TYPE_END; k++)
+            {
+                if (strlen(jobTypes[k].name) == (size_t)(equals - spec) && !strncmp(spec, jobTypes[k].name, equals - spec))
+                {
+                    type = k;
+                }
+            }
+            double seconds = 0;
+            if (type != NO_JOB && !strcmp(equals + 1, "drop-newest"))
+            {
+                jobTypes[type].overload = OVERLOAD_DROP_NEWEST;
+            }
+            else if (type != NO_JOB && !strcmp(equals + 1, "drop-oldest"))
+            {
+                jobTypes[type].overload = OVERLOAD_DROP_OLDEST;
+            }
+            else if (type != NO_JOB && !strcmp(equals + 1, "block"))
+            {
+                jobTypes[type].overload = OVERLOAD_BLOCK;
+            }
+            else if (type != NO_JOB && sscanf(equals + 1, "reject:%lf", &seconds) == 1 && seconds >= 0)
+            {
+                jobTypes[type].overload = OVERLOAD_REJECT;
+                jobTypes[type].rejectAbove = lround(seconds * 1000);
+            }
+            else
+            {
+                fprintf(stderr, "invalid --overload: %s\n", spec);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--towers"))
+        {
+            towerCount = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--migrate-margin"))
+        {
+            migrateMargin = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--pad-caps"))
+        {
+            // applied once the pads exist
+            padCapabilitySpecs[padCapabilitySpecCount++] = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--outage"))
+        {
+            // applied once the pads exist
+            outageSpecs[outageSpecCount++] = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--outages"))
+        {
+            if (sscanf(argv[++i], "%lf,%lf", &outageUp, &outageDown) != 2 || outageUp <= 0 || outageDown <= 0)
+            {
+                fprintf(stderr, "invalid --outages: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--autoscale"))
+        {
+            if (sscanf(argv[++i], "%d,%d", &scaleMin, &scaleMax) != 2 || scaleMin < 1 || scaleMax < scaleMin)
+            {
+                fprintf(stderr, "invalid --autoscale: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--scale-up"))
+        {
+            scaleUp = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--scale-down"))
+        {
+            scaleDown = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--scale-hold"))
+        {
+            scaleHold = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--scale-signal"))
+        {
+            i++;
+            if (!strcmp(argv[i], "wait") || !strcmp(argv[i], "backlog"))
+            {
+                scaleOnWait = !strcmp(argv[i], "wait");
+            }
+            else
+            {
+                fprintf(stderr, "invalid --scale-signal: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--ingest"))
+        {
+            ingestName = argv[++i];
+            char *comma = strchr(ingestName, ',');
+            if (comma != NULL)
+            {
+                *comma = '\0';
+                ingestCapacity = atoi(comma + 1);
+            }
+            if (ingestCapacity < 1)
+            {
+                fprintf(stderr, "invalid --ingest capacity\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--dispatch"))
+        {
+            char *mode = argv[++i];
+            if (!strcmp(mode, "push") || !strcmp(mode, "pull") || !strcmp(mode, "compare"))
+            {
+                pullDispatch = !strcmp(mode, "pull");
+                compareDispatch = !strcmp(mode, "compare");
+            }
+            else
+            {
+                fprintf(stderr, "invalid --dispatch: %s\n", mode);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--stress"))
+        {
+            stress = TRUE;
+        }
+        else if (!strcmp(argv[i], "--stress-start"))
+        {
+            stressStart = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--stress-step"))
+        {
+            stressStepMillis = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--fifo"))
+        {
+            fifoPriority = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--jitter"))
+        {
+            jitterEnabled = TRUE;
+        }
+        else if (!strcmp(argv[i], "--quiet"))
+        {
+            quiet = TRUE;
+        }
+        else if (!strcmp(argv[i], "--sample"))
+        {
+            sampleInterval = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--pad-window"))
+        {
+            padWindow = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--sample-capacity"))
+        {
+            sampleCapacity = atoi(argv[++i]);
+        }
     }
 
-    srand(seed); // feed the seed
-
-    // your code goes here
+    if (padCount < 1)
+    {
+        padCount = 1;
+    }
+    if (sampleCapacity < 1)
+    {
+        sampleCapacity = 1;
+    }
+    if (producerCount < 1)
+    {
+        producerCount = 1;
+    }
+    if (towerCount < 1)
+    {
+        towerCount = 1;
+    }
+    if (towerCount > 1 && (checkpointPath != NULL || restorePath != NULL))
+    {
+        // a checkpoint has one set of intake queues
+        fprintf(stderr, "--checkpoint and --restore need a single tower\n");
+        return 1;
+    }
+    if (scaleMax > 0)
+    {
+        if (restorePath != NULL)
+        {
+            // a checkpoint decides the pad count
+            fprintf(stderr, "--autoscale can't be combined with --restore\n");
+            return 1;
+        }
+        padCount = scaleMax;
+        if (scaleDown > scaleUp)
+        {
+            scaleDown = scaleUp;
+        }
+    }
+    if (stress)
+    {
+        // printing every queued ID and polling idle pads every UNIT_TIME would be what is measured
+        quiet = TRUE;
+        idleMillis = STRESS_TICK_MILLIS;
+        if (stressStart < 1)
+        {
+            stressStart = 1;
+        }
+        if (stressStepMillis < 1)
+        {
+            stressStepMillis = 1;
+        }
+    }
 
-    // Start the simulation
-    simulationStartTime = time(NULL);
+    // the runs of --dispatch compare are children, forked before any thread exists
+    if (compareDispatch && !CompareDispatch())
+    {
+        return 0;
+    }
+
+    // the checkpoint decides how many pads and producers there are
+    FILE *checkpoint = NULL;
+    if (restorePath != NULL)
+    {
+        checkpoint = OpenCheckpoint(restorePath);
+        if (checkpoint == NULL)
+        {
+            fprintf(stderr, "could not restore from %s\n", restorePath);
+            return 1;
+        }
+    }
+
+    // every tower needs a pad
+    if (padCount < towerCount)
+    {
+        padCount = towerCount;
+        scaleMax = scaleMax > 0 ? padCount : 0;
+    }
+
+    InitJobTypes();
+
+    QueueClass queueModel[JOB_TYPE_END];
+    if (estimate)
+    {
+        BuildQueueModel(queueModel);
+        PrintEstimate(queueModel);
+        if (!estimateCheck)
+        {
+            return 0;
+        }
+    }
+
+    // feed the seed, every producer gets its own random number generator
+    allProducerCount = 0;
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        allProducerCount += jobTypes[type].producers;
+    }
+    producers = (Producer *)calloc(allProducerCount, sizeof(Producer));
+    for (int type = LANDING_JOB, i = 0; type < JOB_TYPE_END; type++)
+    {
+        for (int k = 0; k < jobTypes[type].producers; k++, i++)
+        {
+            producers[i].type = type;
+            producers[i].rng = (uint64_t)seed * 1000003 + i;
+            SamplerInit(&producers[i].arrivals, &jobTypes[type].arrival);
+            SamplerInit(&producers[i].services, &jobTypes[type].service);
+        }
+    }
+
+    if (tracePath != NULL)
+    {
+        TraceStart();
+    }
+
+    // your code goes here
+
+    // Start the simulation, the ms clock starts now and not at the whole second
+    startMillis = EpochMillis();
+    simulationStartTime = startMillis / 1000;
 
     // open the log.txt and write the header for the columns EventID, Status, Request Time, End Time, Turnaround Time, Pad
+    // and the turnaround split into the time waiting for the tower, waiting in the pad queue and being served
     FILE *logFile = fopen("log.txt", "w");
-    fprintf(logFile, "EventID, Status, Request Time, End Time, Turnaround Time, Pad\n");
+    fprintf(logFile, "EventID, Status, Request Time, End Time, Turnaround Time, Pad, Intake Wait, Pad Wait, Service Time\n");
     fclose(logFile);
+    logFd = open("log.txt", O_WRONLY | O_APPEND);
 
     // add current time to the simulationTime to get the deadline
     deadline = time(NULL) + simulationTime;
 
     // construct the queues
-    landingQueue = ConstructQueue(1000);
-    launchQueue = ConstructQueue(1000);
-    assemblyQueue = ConstructQueue(1000);
-    emergencyQueue = ConstructQueue(1000);
-    padAEmergencyQueue = ConstructQueue(1000);
-    padBEmergencyQueue = ConstructQueue(1000);
-    padAQueue = ConstructQueue(1000);
-    padBQueue = ConstructQueue(1000);
-
-    // add first launch job to the launch queue
-    Job j;
-    j.ID = rand() % 1000;
-    j.type = LAUNCH_JOB;
-    j.duration = LAUNCH_JOB_DURATION;
-    j.arrivalTime = time(NULL) - simulationStartTime;
-    Enqueue(launchQueue, j);
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        *jobTypes[type].queue = ConstructQueue(queueLimit);
+    }
+
+    // construct the pads, named A, B, C, ... and P27, P28, ... after Z
+    pads = (Pad *)calloc(padCount, sizeof(Pad));
+    for (int i = 0; i < padCount; i++)
+    {
+        if (i < 26)
+        {
+            sprintf(pads[i].name, "%c", 'A' + i);
+        }
+        else
+        {
+            sprintf(pads[i].name, "P%d", i + 1);
+        }
+        pads[i].index = i;
+        atomic_init(&pads[i].accountState, JOB_TYPE_END); // idle until its first segment
+        sprintf(pads[i].threadName, "Pad%s", pads[i].name);
+        pads[i].queue = ConstructQueue(queueLimit);
+        pads[i].emergencyQueue = ConstructQueue(queueLimit);
+        pthread_mutex_init(&pads[i].queueMutex, NULL);
+        pthread_mutex_init(&pads[i].emergencyQueueMutex, NULL);
+        pthread_cond_init(&pads[i].emergencyCond, NULL);
+    }
+
+    // construct the shards, the first one takes the intake queues and mutexes of the job types
+    shards = (Shard *)calloc(towerCount, sizeof(Shard));
+    for (int s = 0; s < towerCount; s++)
+    {
+        Shard *shard = &shards[s];
+        shard->index = s;
+        sprintf(shard->threadName, s == 0 ? "ControlTower" : "ControlTower%d", s);
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            shard->queues[type] = s == 0 ? *jobTypes[type].queue : ConstructQueue(queueLimit);
+            shard->mutexes[type] = s == 0 ? jobTypes[type].mutex : &shard->ownMutexes[type];
+        }
+        shard->pads = (Pad **)malloc(((padCount + towerCount - 1) / towerCount) * sizeof(Pad *));
+        for (int i = s; i < padCount; i += towerCount)
+        {
+            shard->pads[shard->padCount++] = &pads[i];
+        }
+        // the tower's old rule: launches on the shard's 1st, 3rd, ... pads and assemblies on its 2nd, 4th, ...
+        for (int k = 0; k < shard->padCount; k++)
+        {
+            shard->pads[k]->capabilities = ~0u;
+            if (shard->padCount > 1)
+            {
+                shard->pads[k]->capabilities &= ~TYPE_MASK(k % 2 == 0 ? ASSEMBLY_JOB : LAUNCH_JOB);
+            }
+        }
+        shard->mailbox = MailboxCreate(MAILBOX_CAPACITY);
+        sprintf(shard->logName, s == 0 ? "log" : "log%d", s);
+        shard->log = (char *)malloc(LOG_BUFFER);
+    }
+
+    // list every queue for the sampler, intake queues are named landing0, landing1, ... with several towers
+    int intakeCount = (JOB_TYPE_END - LANDING_JOB) * towerCount;
+    allQueueCount = intakeCount + 2 * padCount;
+    allQueues = (Queue **)malloc(allQueueCount * sizeof(Queue *));
+    allQueueNames = malloc(allQueueCount * sizeof(*allQueueNames));
+    for (int s = 0, k = 0; s < towerCount; s++)
+    {
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++, k++)
+        {
+            allQueues[k] = shards[s].queues[type];
+            sprintf(allQueueNames[k], towerCount > 1 ? "%s%d" : "%s", jobTypes[type].name, s);
+        }
+    }
+    for (int i = 0; i < padCount; i++)
+    {
+        allQueues[intakeCount + i] = pads[i].queue;
+        allQueues[intakeCount + padCount + i] = pads[i].emergencyQueue;
+        sprintf(allQueueNames[intakeCount + i], "pad%s", pads[i].name);
+        sprintf(allQueueNames[intakeCount + padCount + i], "pad%s emergency", pads[i].name);
+    }
+
+    // the delta display needs the queues to record their changes from the start
+    if (deltaDisplay && !quiet)
+    {
+        spareJournals = (QueueJournal **)malloc(allQueueCount * sizeof(QueueJournal *));
+        for (int k = 0; k < allQueueCount; k++)
+        {
+            allQueues[k]->journal = CreateJournal(DISPLAY_CHANGES);
+            spareJournals[k] = CreateJournal(DISPLAY_CHANGES);
+        }
+    }
+
+    if (checkpoint != NULL)
+    {
+        // continue from the checkpoint's queues and clock
+        if (!LoadCheckpoint(checkpoint))
+        {
+            fprintf(stderr, "%s is not a valid checkpoint\n", restorePath);
+            return 1;
+        }
+        deadline = time(NULL) + simulationTime;
+        for (int i = 0; i < allQueueCount; i++)
+        {
+            atomic_fetch_add(&jobsInSystem, QueueSize(allQueues[i]));
+        }
+    }
+    else if (!stress) // a 4 s job would hold up every launch of a stress run
+    {
+        // add first launch job to the launch queue
+        Job j = CreateJob(LAUNCH_JOB, LAUNCH_JOB_DURATION * 1000);
+        Enqueue(launchQueue, j);
+        atomic_fetch_add(&jobsInSystem, 1);
+    }
+
+    // the pads account their time from the start of this run, which a restore moved to the checkpoint's clock
+    runStartMillis = CurrentMillis();
+    for (int i = 0; i < padCount; i++)
+    {
+        atomic_store(&pads[i].accountSince, runStartMillis);
+    }
+
+    // index the pads of every shard by the job types they serve
+    for (int k = 0; k < padCapabilitySpecCount; k++)
+    {
+        if (!SetPadCapabilities(padCapabilitySpecs[k]))
+        {
+            fprintf(stderr, "invalid --pad-caps: %s\n", padCapabilitySpecs[k]);
+            return 1;
+        }
+    }
+
+    // with --autoscale every shard starts with its pads among the first min, and more if they leave a job type
+    // without a pad, the others are parked
+    for (int s = 0; scaleMax > 0 && s < towerCount; s++)
+    {
+        Shard *shard = &shards[s];
+        for (int k = 0; k < shard->padCount; k++)
+        {
+            shard->pads[k]->parked = TRUE;
+        }
+        for (int k = 0; k < shard->padCount; k++)
+        {
+            Pad *pad = shard->pads[k];
+            if (pad->index < scaleMin || shard->activePads == 0 || !CoversAllTypes(shard, NULL))
+            {
+                pad->parked = FALSE;
+                shard->activePads++;
+            }
+            else
+            {
+                atomic_store(&pad->down, TRUE);
+            }
+        }
+        shard->minPads = (scaleMin - s + towerCount - 1) / towerCount; // its pads among the first min
+        if (shard->minPads < 1)
+        {
+            shard->minPads = 1;
+        }
+        activePads += shard->activePads;
+    }
+
+    for (int s = 0; s < towerCount; s++)
+    {
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            PadIndex *index = &shards[s].capable[type];
+            index->pads = (Pad **)malloc(shards[s].padCount * sizeof(Pad *));
+            index->keys = (long *)malloc(shards[s].padCount * sizeof(long));
+            for (int k = 0; k < shards[s].padCount; k++)
+            {
+                Pad *pad = shards[s].pads[k];
+                // restored pad queues are work the tower already gave out
+                pad->projectedFinish = CurrentMillis() + QueueDuration(pad->queue) + QueueDuration(pad->emergencyQueue);
+                if (pad->parked)
+                {
+                    pad->projectedFinish = LONG_MAX / 2;
+                }
+                if (pad->capabilities & TYPE_MASK(type))
+                {
+                    PadIndexAdd(index, pad);
+                }
+            }
+            if (index->count == 0)
+            {
+                fprintf(stderr, "no pad of %s can serve %s jobs\n", shards[s].threadName, jobTypes[type].name);
+                return 1;
+            }
+        }
+    }
+    free(padCapabilitySpecs);
+
+    if (scaleMax > 0)
+    {
+        scaleSince = CurrentMillis();
+        scaleMillis = (long *)calloc(padCount + 1, sizeof(long));
+        scaleJobs = (atomic_long *)calloc(padCount + 1, sizeof(atomic_long));
+        scaleTurnaround = (atomic_long *)calloc(padCount + 1, sizeof(atomic_long));
+    }
+
+    // the outage windows, random ones are drawn up front for the whole run from the seed
+    for (int k = 0; k < outageSpecCount; k++)
+    {
+        if (!ParseOutage(outageSpecs[k]))
+        {
+            fprintf(stderr, "invalid --outage: %s\n", outageSpecs[k]);
+            return 1;
+        }
+    }
+    free(outageSpecs);
+    for (int i = 0; outageUp > 0 && i < padCount; i++)
+    {
+        uint64_t rng = (uint64_t)seed * 7919 + i;
+        long end = CurrentMillis() + simulationTime * 1000L;
+        for (long t = CurrentMillis() - lround(outageUp * 1000 * log(NextUniform(&rng))); t < end;)
+        {
+            long length = 1 - lround(outageDown * 1000 * log(NextUniform(&rng)));
+            AddOutage(&pads[i], t, t + length);
+            t += length - lround(outageUp * 1000 * log(NextUniform(&rng)));
+        }
+    }
+    if (outageCount > 0)
+    {
+        timelineSeconds = CurrentMillis() / 1000 + simulationTime + 2;
+        timelineJobs = (atomic_long *)calloc(timelineSeconds, sizeof(atomic_long));
+        timelineTurnaround = (atomic_long *)calloc(timelineSeconds, sizeof(atomic_long));
+    }
 
     // initialize mutexes
-    pthread_mutex_init(&landingQueueMutex, NULL);
-    pthread_mutex_init(&launchQueueMutex, NULL);
-    pthread_mutex_init(&assemblyQueueMutex, NULL);
-    pthread_mutex_init(&emergencyQueueMutex, NULL);
-    pthread_mutex_init(&padAEmergencyQueueMutex, NULL);
-    pthread_mutex_init(&padBEmergencyQueueMutex, NULL);
-    pthread_mutex_init(&padAQueueMutex, NULL);
-    pthread_mutex_init(&padBQueueMutex, NULL);
-    pthread_mutex_init(&logFileMutex, NULL);
+    for (int s = 0; s < towerCount; s++)
+    {
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            pthread_mutex_init(shards[s].mutexes[type], NULL);
+        }
+    }
+    for (int s = 0; s < towerCount; s++)
+    {
+        pthread_mutex_init(&shards[s].logMutex, NULL);
+    }
+
+    // name the locks and pads in the trace
+    for (int s = 0, k = 0; s < towerCount; s++)
+    {
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++, k++)
+        {
+            TraceNameObject(shards[s].mutexes[type], s == 0 ? jobTypes[type].queueName : allQueueNames[k]);
+        }
+    }
+    for (int s = 0; s < towerCount; s++)
+    {
+        TraceNameObject(&shards[s].logMutex, shards[s].logName);
+    }
+    for (int i = 0; i < padCount; i++)
+    {
+        TraceNameObject(&pads[i].queueMutex, allQueueNames[intakeCount + i]);
+        TraceNameObject(&pads[i].emergencyQueueMutex, allQueueNames[intakeCount + padCount + i]);
+        TraceNamePad(i, pads[i].name);
+    }
+
+    // the first tower takes jobs from the ring as soon as it runs
+    if (ingestName != NULL && !IngestCreate(&ingestRing, ingestName, ingestCapacity))
+    {
+        fprintf(stderr, "could not create the ingestion ring %s\n", ingestName);
+        return 1;
+    }
 
     // declare the threads
-    pthread_t landingThread;
-    pthread_t launchThread;
-    pthread_t assemblyThread;
-    pthread_t emergencyThread;
-    pthread_t controlTowerThread;
-    pthread_t padAThread;
-    pthread_t padBThread;
+    pthread_t *producerThreads = (pthread_t *)malloc(allProducerCount * sizeof(pthread_t));
+    pthread_t *controlTowerThreads = (pthread_t *)malloc(towerCount * sizeof(pthread_t));
+    pthread_t *padThreads = (pthread_t *)malloc(padCount * sizeof(pthread_t));
     pthread_t printCurrentQueuesThread;
+    pthread_t samplerThread;
+    pthread_t padWindowThread;
 
     // create the threads
-    pthread_create(&landingThread, NULL, LandingJob, NULL);
-    pthread_create(&launchThread, NULL, LaunchJob, NULL);
-    pthread_create(&assemblyThread, NULL, AssemblyJob, NULL);
-    pthread_create(&emergencyThread, NULL, EmergencyJob, NULL);
-    pthread_create(&controlTowerThread, NULL, ControlTower, NULL);
-    pthread_create(&padAThread, NULL, PadA, NULL);
-    pthread_create(&padBThread, NULL, PadB, NULL);
-    pthread_create(&printCurrentQueuesThread, NULL, PrintCurrentQueues, NULL);
+    // threads of a role given a cpu list are pinned and, with --fifo, real time scheduled
+    for (int s = 0; s < towerCount; s++)
+    {
+        CreateThread(&controlTowerThreads[s], ControlTower, &shards[s], CpuFor(&towerCpus, s), towerCpus.count ? fifoPriority : 0);
+    }
+    if (workerCount > 0)
+    {
+        for (int i = 0; i < allProducerCount; i++)
+        {
+            producers[i].task.step = ProducerTask;
+            producers[i].task.arg = &producers[i];
+            ExecutorSchedule(&producers[i].task, NextArrivalDelay(&producers[i]));
+        }
+        for (int i = 0; i < padCount; i++)
+        {
+            pads[i].task.step = PadTask;
+            pads[i].task.arg = &pads[i];
+            ExecutorSchedule(&pads[i].task, 0);
+        }
+        ExecutorStart(workerCount);
+    }
+    else
+    {
+        for (int i = 0; i < allProducerCount; i++)
+        {
+            CreateThread(&producerThreads[i], ProducerThread, &producers[i], CpuFor(&producerCpus, i), producerCpus.count ? fifoPriority : 0);
+        }
+        for (int i = 0; i < padCount; i++)
+        {
+            CreateThread(&padThreads[i], LaunchPad, &pads[i], CpuFor(&padCpus, i), padCpus.count ? fifoPriority : 0);
+        }
+    }
+    if (!quiet)
+    {
+        pthread_create(&printCurrentQueuesThread, NULL, PrintCurrentQueues, NULL);
+    }
+    if (sampleInterval > 0)
+    {
+        pthread_create(&samplerThread, NULL, QueueSampler, NULL);
+    }
+    if (padWindow > 0)
+    {
+        pthread_create(&padWindowThread, NULL, PadWindowSampler, NULL);
+    }
+    if (metricsPath != NULL && !StartMetricsServer(metricsPath, WriteMetrics))
+    {
+        fprintf(stderr, "could not serve metrics on %s\n", metricsPath);
+    }
+
+    // wait for the deadline, then wake every thread up so they exit promptly
+    if (stress)
+    {
+        RunStress();
+    }
+    else
+    {
+        pthread_sleep(simulationTime);
+    }
+    if (drain)
+    {
+        Drain();
+    }
+    Shutdown();
+    if (ingestName != NULL)
+    {
+        IngestClose(&ingestRing);
+    }
 
     // join threads
-    pthread_join(landingThread, NULL);
-    pthread_join(launchThread, NULL);
-    pthread_join(assemblyThread, NULL);
-    pthread_join(emergencyThread, NULL);
-    pthread_join(controlTowerThread, NULL);
-    pthread_join(padAThread, NULL);
-    pthread_join(padBThread, NULL);
-    pthread_join(printCurrentQueuesThread, NULL);
+    for (int s = 0; s < towerCount; s++)
+    {
+        pthread_join(controlTowerThreads[s], NULL);
+    }
+    if (workerCount > 0)
+    {
+        ExecutorStop();
+    }
+    else
+    {
+        for (int i = 0; i < allProducerCount; i++)
+        {
+            pthread_join(producerThreads[i], NULL);
+        }
+        for (int i = 0; i < padCount; i++)
+        {
+            pthread_join(padThreads[i], NULL);
+        }
+    }
+    for (int s = 0; s < towerCount; s++)
+    {
+        FlushLog(&shards[s]);
+    }
+    close(logFd);
+    if (!quiet)
+    {
+        pthread_join(printCurrentQueuesThread, NULL);
+    }
+    StopMetricsServer();
+    if (sampleInterval > 0)
+    {
+        pthread_join(samplerThread, NULL);
+        DumpSamples();
+    }
+    if (padWindow > 0)
+    {
+        pthread_join(padWindowThread, NULL);
+        DumpPadWindows();
+    }
+
+    PrintBacklogReport();
+    if (ingestName != NULL)
+    {
+        PrintIngestReport();
+        IngestDestroy(&ingestRing);
+    }
+
+    if (checkpointPath != NULL && !WriteCheckpoint(checkpointPath))
+    {
+        fprintf(stderr, "could not write the checkpoint to %s\n", checkpointPath);
+    }
 
     // destroy queues
-    DestructQueue(landingQueue);
-    DestructQueue(launchQueue);
-    DestructQueue(assemblyQueue);
-    DestructQueue(emergencyQueue);
-    DestructQueue(padAEmergencyQueue);
-    DestructQueue(padBEmergencyQueue);
-    DestructQueue(padAQueue);
-    DestructQueue(padBQueue);
+    for (int s = 0; s < towerCount; s++)
+    {
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            DestructQueue(shards[s].queues[type]);
+        }
+    }
+    for (int i = 0; i < padCount; i++)
+    {
+        DestructQueue(pads[i].queue);
+        DestructQueue(pads[i].emergencyQueue);
+    }
+    for (int k = 0; spareJournals != NULL && k < allQueueCount; k++)
+    {
+        DestroyJournal(spareJournals[k]);
+    }
+    free(spareJournals);
+    if (jitterEnabled)
+    {
+        PrintJitterReport();
+    }
+    if (estimateCheck)
+    {
+        PrintEstimateCheck(queueModel);
+    }
+    PrintPadReport();
+    PrintOverloadReport();
+    if (outageCount > 0)
+    {
+        PrintOutageReport();
+    }
+    if (scaleMax > 0)
+    {
+        PrintScaleReport();
+    }
+    if (towerCount > 1)
+    {
+        PrintTowerReport();
+    }
+
+    if (tracePath != NULL && !TraceWrite(tracePath))
+    {
+        fprintf(stderr, "could not write the trace to %s\n", tracePath);
+    }
+
+    for (int s = 0; s < towerCount; s++)
+    {
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            free(shards[s].capable[type].pads);
+            free(shards[s].capable[type].keys);
+        }
+        free(shards[s].pads);
+        free(shards[s].mailbox);
+        free(shards[s].log);
+    }
+    // report to the parent of --dispatch compare
+    if (summaryFd >= 0)
+    {
+        DispatchSummary summary;
+        for (int type = 0; type < JOB_TYPE_END; type++)
+        {
+            summary.completed[type] = atomic_load(&completedJobs[type]);
+            summary.waitMillis[type] = atomic_load(&waitMillis[type]);
+            summary.sojournMillis[type] = atomic_load(&sojournMillis[type]);
+        }
+        summary.turnaround[0] = HistogramPercentile(&turnaroundHistogram, 0.5);
+        summary.turnaround[1] = HistogramPercentile(&turnaroundHistogram, 0.9);
+        summary.turnaround[2] = HistogramPercentile(&turnaroundHistogram, 0.99);
+        if (write(summaryFd, &summary, sizeof(summary)) != sizeof(summary))
+        {
+            perror("write");
+        }
+        close(summaryFd);
+    }
+
+    free(shards);
+    free(outages);
+    free(timelineJobs);
+    free(timelineTurnaround);
+    free(scaleMillis);
+    free(scaleJobs);
+    free(scaleTurnaround);
+    free(controlTowerThreads);
+    free(pads);
+    free(padThreads);
+    free(producerThreads);
+    free(producers);
+    free(allQueues);
+    free(allQueueNames);
 
     return 0;
 }
 
-// the function that creates plane threads for landing
-void *LandingJob(void *arg)
-{
-    while (time(NULL) < deadline)
+// fill in the arrival parameters of the JOB_TYPES table
+void InitJobTypes()
+{
+#define JOB_TYPE_ARRIVALS(TYPE, name, letter, duration, count, every, size, chance) \
+    jobTypes[TYPE##_JOB].producers = count;                                    \
+    jobTypes[TYPE##_JOB].period = every;                                       \
+    jobTypes[TYPE##_JOB].batch = size;                                         \
+    jobTypes[TYPE##_JOB].percent = chance;
+    JOB_TYPES(JOB_TYPE_ARRIVALS)
+
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        if (jobTypes[type].service.kind == DIST_NONE)
+        {
+            jobTypes[type].service.kind = DIST_FIXED;
+            jobTypes[type].service.a = jobTypes[type].duration;
+        }
+        // a blocked producer stops offering load, so stress mode drops instead
+        if (stress && jobTypes[type].overload == OVERLOAD_BLOCK)
+        {
+            jobTypes[type].overload = OVERLOAD_DROP_NEWEST;
+        }
+    }
+}
+
+// the function that creates plane threads, one per producer of every job type
+void *ProducerThread(void *arg)
+{
+    Producer *producer = (Producer *)arg;
+    JobType *jobType = &jobTypes[producer->type];
+    TraceThread(jobType->producerName);
+    jitterRole = JITTER_PRODUCERS;
+
+    // sleep until the next arrival (slot)
+    long delay = NextArrivalDelay(producer);
+    while (ArrivalsOpen())
+    {
+        SleepMillis(delay);
+        if (!ArrivalsOpen())
+        {
+            break;
+        }
+
+        delay = ProducerStep(producer);
+    }
+
+    return NULL;
+}
+
+// one wake up of a producer, returns the milliseconds until the next one. A blocked producer retries
+// its blocked jobs and has no new arrivals until they are admitted.
+long ProducerStep(Producer *producer)
+{
+    if (producer->blocked == 0)
+    {
+        Produce(producer);
+    }
+    else
+    {
+        while (producer->blocked > 0)
+        {
+            Job j = producer->blockedJob;
+            if (!Admit(j))
+            {
+                return BLOCK_RETRY_MILLIS;
+            }
+            producer->blocked--;
+            if (producer->blocked > 0)
+            {
+                long service = lround(Sample(&producer->services, &producer->rng) * 1000);
+                producer->blockedJob = CreateJob(producer->type, service > 0 ? service : 1);
+            }
+        }
+        atomic_fetch_add(&blockedMillis[producer->type], CurrentMillis() - producer->blockedSince);
+    }
+    return producer->blocked > 0 ? BLOCK_RETRY_MILLIS : NextArrivalDelay(producer);
+}
+
+// milliseconds until the producer's next arrival, or next arrival slot if the type has no arrival distribution
+long NextArrivalDelay(Producer *producer)
+{
+    JobType *jobType = &jobTypes[producer->type];
+    if (stress && producer->type != EMERGENCY_JOB)
+    {
+        return STRESS_TICK_MILLIS;
+    }
+    if (jobType->arrival.kind == DIST_NONE)
+    {
+        return jobType->period * UNIT_TIME * 1000L;
+    }
+    return lround(Sample(&producer->arrivals, &producer->rng) * 1000);
+}
+
+// one arrival of a producer: a batch of jobs arrives at its intake queue, in slot mode only with the type's probability
+void Produce(Producer *producer)
+{
+    JobType *jobType = &jobTypes[producer->type];
+    if (stress && producer->type != EMERGENCY_JOB)
+    {
+        StressProduce(producer);
+        return;
+    }
+    if (jobType->arrival.kind != DIST_NONE || NextRandom(&producer->rng) % 100 < jobType->percent)
+    {
+        for (int i = 0; i < jobType->batch; i++)
+        {
+            // at least a millisecond, so every job has a segment on the pad
+            long service = lround(Sample(&producer->services, &producer->rng) * 1000);
+            Job j = CreateJob(producer->type, service > 0 ? service : 1);
+
+            if (!Admit(j))
+            {
+                // the rest of the batch is created as the blocked jobs are admitted
+                producer->blockedJob = j;
+                producer->blocked = jobType->batch - i;
+                producer->blockedSince = CurrentMillis();
+                atomic_fetch_add(&blockedJobs[producer->type], 1);
+                return;
+            }
+        }
+    }
+}
+
+// stress mode arrivals: the producer's share of the offered load as zero-duration jobs, all it owes since its last step
+void StressProduce(Producer *producer)
+{
+    long now = CurrentMillis();
+    if (producer->lastStep > 0)
+    {
+        int stressProducers = allProducerCount - jobTypes[EMERGENCY_JOB].producers;
+        double rate = (double)atomic_load(&stressRate) / stressProducers;
+        producer->owed += rate * (now - producer->lastStep) / 1000;
+        // a producer that was starved of the CPU catches up on at most one tick, bursts would skew the latency
+        double most = rate * STRESS_TICK_MILLIS / 1000 + 1;
+        if (producer->owed > most)
+        {
+            producer->owed = most;
+        }
+    }
+    producer->lastStep = now;
+
+    long count = (long)producer->owed;
+    producer->owed -= count;
+    for (long i = 0; i < count; i++)
+    {
+        Admit(CreateJob(producer->type, 0));
+    }
+    atomic_fetch_add(&stressOffered, count);
+}
+
+// ramp the offered load of stress mode in steps, doubling it until a step is past the knee: more than 1% of
+// the jobs are dropped, the pads complete less than 90% of them, or the p99 dispatch latency is 10 times the
+// first step's (and at least 5 ms). A step the producers could not create 90% of is past it too, the machine
+// ran out of CPU. Prints each step and the highest load sustained.
+void RunStress()
+{
+    long completedBefore = 0, droppedBefore = 0, offeredBefore = 0;
+    long firstP99 = -1, sustained = 0, knee = 0;
+    long end = CurrentMillis() + simulationTime * 1000L;
+
+    printf("Stress (%d producers, %d pads, %d ms steps)\n", allProducerCount - jobTypes[EMERGENCY_JOB].producers, padCount, stressStepMillis);
+    printf("%10s %12s %12s %12s %10s %10s %10s %10s\n", "Offered/s", "Created/s", "Completed/s", "Dropped/s", "p50 ms", "p99 ms", "Max ms", "Backlog");
+    for (int step = 0; step < MAX_STRESS_STEPS && knee == 0 && CurrentMillis() < end; step++)
+    {
+        long rate = stressStart << step;
+        atomic_store(&stressStep, step);
+        atomic_store(&stressRate, rate);
+
+        long start = CurrentMillis();
+        SleepMillis(stressStepMillis);
+        double seconds = (CurrentMillis() - start) / 1000.0;
+
+        long completed = 0, dropped = 0, backlog = 0;
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            completed += atomic_load(&completedJobs[type]);
+            dropped += atomic_load(&droppedJobs[type]) + atomic_load(&rejectedJobs[type]);
+        }
+        for (int i = 0; i < allQueueCount; i++)
+        {
+            backlog += QueueSize(allQueues[i]);
+        }
+        long offered = atomic_load(&stressOffered);
+        double created = (offered - offeredBefore) / seconds;
+        double done = (completed - completedBefore) / seconds;
+        double drops = (dropped - droppedBefore) / seconds;
+        completedBefore = completed;
+        droppedBefore = dropped;
+        offeredBefore = offered;
+
+        Histogram *latency = &stressLatency[step];
+        long p99 = HistogramPercentile(latency, 0.99);
+        printf("%10ld %12.0f %12.0f %12.0f %10ld %10ld %10ld %10ld\n", rate, created, done, drops, HistogramPercentile(latency, 0.5), p99,
+               HistogramPercentile(latency, 1.0), backlog);
+        fflush(stdout);
+
+        if (firstP99 < 0)
+        {
+            firstP99 = p99;
+        }
+        if (drops > 0.01 * created || done < 0.9 * created || (p99 >= 5 && p99 > 10 * firstP99) || created < 0.9 * rate)
+        {
+            knee = rate;
+        }
+        else
+        {
+            sustained = done;
+        }
+    }
+
+    if (knee > 0)
+    {
+        printf("Knee at %ld offered jobs/s, highest sustained %ld jobs/s\n", knee, sustained);
+    }
+    else
+    {
+        printf("No knee up to %ld offered jobs/s, highest sustained %ld jobs/s\n", stressStart << (MAX_STRESS_STEPS - 1), sustained);
+    }
+}
+
+// enqueue a new job at its intake queue under the type's overload policy,
+// returns FALSE if the producer has to block and try again later
+int Admit(Job j)
+{
+    JobType *jobType = &jobTypes[j.type];
+    Shard *shard = ShardOf(j);
+    pthread_mutex_t *mutex = shard->mutexes[j.type];
+    if (jobType->overload == OVERLOAD_REJECT && PredictedWait(shard, j.type) > jobType->rejectAbove)
+    {
+        atomic_fetch_add(&rejectedJobs[j.type], 1);
+        TraceInstant("reject", j.ID);
+        return TRUE;
+    }
+
+    LockMutex(mutex);
+
+    Queue *queue = shard->queues[j.type];
+    if (isFull(queue))
+    {
+        if (jobType->overload == OVERLOAD_BLOCK)
+        {
+            UnlockMutex(mutex);
+            return FALSE;
+        }
+        if (jobType->overload == OVERLOAD_DROP_OLDEST)
+        {
+            Job oldest = Dequeue(queue);
+            atomic_fetch_add(&droppedJobs[j.type], 1);
+            atomic_fetch_sub(&jobsInSystem, 1);
+            TraceInstant("drop", oldest.ID);
+        }
+        else
+        {
+            atomic_fetch_add(jobType->overload == OVERLOAD_REJECT ? &rejectedJobs[j.type] : &droppedJobs[j.type], 1);
+            TraceInstant("drop", j.ID);
+            UnlockMutex(mutex);
+            return TRUE;
+        }
+    }
+    Enqueue(queue, j);
+    atomic_fetch_add(&jobsInSystem, 1);
+    TraceInstant(jobType->enqueueEvent, j.ID);
+
+    UnlockMutex(mutex);
+    if (pullDispatch && j.type != EMERGENCY_JOB)
+    {
+        WakeReadyPad(shard, j.type);
+    }
+    return TRUE;
+}
+
+// how long a new job of the type would wait before a pad of the shard starts it, from the lock free queue
+// durations: its share of the intake backlog plus the backlog of the pad the tower would give it to
+long PredictedWait(Shard *shard, int type)
+{
+    long backlog = QueueDuration(shard->queues[type]);
+    Pad *pad = LeastLoadedPad(shard, type);
+    int up = 0; // the intake backlog is shared by the pads that are up
+    for (int i = 0; i < shard->padCount; i++)
+    {
+        up += PadCanServe(shard->pads[i], type) && !atomic_load(&shard->pads[i]->down);
+    }
+    return backlog / (up > 0 ? up : 1) + QueueDuration(pad->queue);
+}
+
+// the shard a new job goes to, by a hash of its ID so every producer spreads its jobs over all of them
+Shard *ShardOf(Job j)
+{
+    uint64_t hash = j.ID;
+    return &shards[towerCount > 1 ? NextRandom(&hash) % towerCount : 0];
+}
+
+// how far behind the shard's least loaded pad is, in ms. Every queued job counts at least a millisecond,
+// so the zero-duration jobs of --stress are balanced too.
+long ShardLoad(Shard *shard)
+{
+    Pad *pad = NextPadFor(shard, LANDING_JOB);
+    if (pad == NULL)
+    {
+        return LONG_MAX / 2;
+    }
+    return QueueDuration(pad->queue) + QueueSize(pad->queue);
+}
+
+// hand the head of the shard's landing queue to its next free pad, or to the mailbox of the least loaded
+// other shard if that one is more than migrateMargin ms ahead. Called with the landing queue's mutex held,
+// returns FALSE if the job has to stay in the queue.
+int DispatchLanding(Shard *shard)
+{
+    Queue *landings = shard->queues[LANDING_JOB];
+    Pad *pad = NextPadFor(shard, LANDING_JOB);
+
+    if (towerCount > 1)
+    {
+        Shard *idlest = NULL;
+        long idlestLoad = 0;
+        for (int s = 0; s < towerCount; s++)
+        {
+            long load = atomic_load(&shards[s].load);
+            if (s != shard->index && (idlest == NULL || load < idlestLoad))
+            {
+                idlest = &shards[s];
+                idlestLoad = load;
+            }
+        }
+        if (idlestLoad + migrateMargin < ShardLoad(shard) && MailboxPush(idlest->mailbox, landings->head->data))
+        {
+            Dequeue(landings);
+            atomic_fetch_add(&shard->migratedOut, 1);
+            // counted as the target's load until its tower publishes it again, so one pass does not flood it
+            atomic_fetch_add(&idlest->load, LANDING_JOB_DURATION * 1000L + 1);
+            return TRUE;
+        }
+    }
+
+    return DispatchToPad(landings, pad);
+}
+
+// whether the pad may serve jobs of the type, the filter of pull dispatch
+int PadCanServe(Pad *pad, int type)
+{
+    return (pad->capabilities & TYPE_MASK(type)) != 0;
+}
+
+// apply a --pad-caps spec, pad name = log letters of the types it serves. FALSE if the pad or a letter is unknown.
+int SetPadCapabilities(const char *spec)
+{
+    const char *equals = strchr(spec, '=');
+    Pad *pad = NULL;
+    for (int i = 0; equals != NULL && i < padCount; i++)
+    {
+        if (strlen(pads[i].name) == (size_t)(equals - spec) && !strncmp(spec, pads[i].name, equals - spec))
+        {
+            pad = &pads[i];
+        }
+    }
+    if (pad == NULL)
+    {
+        return FALSE;
+    }
+
+    unsigned capabilities = 0;
+    for (const char *letter = equals + 1; *letter; letter++)
+    {
+        int type = LANDING_JOB;
+        while (type < JOB_TYPE_END && jobTypes[type].letter != *letter)
+        {
+            type++;
+        }
+        if (type == JOB_TYPE_END)
+        {
+            return FALSE;
+        }
+        capabilities |= TYPE_MASK(type);
+    }
+    pad->capabilities = capabilities;
+    return TRUE;
+}
+
+// whether a job the pad can serve is waiting in its shard's intake queues, lock free
+int HasReadyJob(Pad *pad)
+{
+    Shard *shard = &shards[pad->index % towerCount];
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        if (type != EMERGENCY_JOB && PadCanServe(pad, type) && QueueSize(shard->queues[type]) > 0)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// pull dispatch: move the job the free pad serves next from its shard's intake queues to its pad queue.
+// Landings go first, like the tower hands them out, unless launch or assembly jobs have piled up (3 or
+// more), then the oldest job the pad can serve goes first. Returns FALSE if there is none.
+int PullJob(Pad *pad)
+{
+    Shard *shard = &shards[pad->index % towerCount];
+    int landingsFirst = QueueSize(shard->queues[LAUNCH_JOB]) < 3 && QueueSize(shard->queues[ASSEMBLY_JOB]) < 3;
+    int locked[JOB_TYPE_END] = {FALSE};
+    int best = NO_JOB;
+
+    // the intake queues are locked in type order, producers lock one at a time so this can't deadlock
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        if (type == EMERGENCY_JOB || !PadCanServe(pad, type) || QueueSize(shard->queues[type]) == 0)
+        {
+            continue;
+        }
+        LockMutex(shard->mutexes[type]);
+        locked[type] = TRUE;
+
+        Queue *queue = shard->queues[type];
+        if (isEmpty(queue) || (landingsFirst && best == LANDING_JOB))
+        {
+            continue;
+        }
+        if (best == NO_JOB || queue->head->data.createdAt < shard->queues[best]->head->data.createdAt)
+        {
+            best = type;
+        }
+    }
+
+    // a pad queue without room leaves the job in the intake queue, not dequeued and lost
+    int pulled = FALSE;
+    if (best != NO_JOB)
+    {
+        LockMutex(&pad->queueMutex);
+        pulled = DispatchJob(shard->queues[best], pad->queue);
+        UnlockMutex(&pad->queueMutex);
+    }
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        if (locked[type])
+        {
+            UnlockMutex(shard->mutexes[type]);
+        }
+    }
+    return pulled;
+}
+
+// pull dispatch: wake one waiting pad of the shard that can serve a job of the type that just arrived
+void WakeReadyPad(Shard *shard, int type)
+{
+    for (int i = 0; i < shard->padCount; i++)
+    {
+        Pad *pad = shard->pads[i];
+        // taking the flag keeps the next arrival from waking the same pad again
+        if (PadCanServe(pad, type) && atomic_exchange(&pad->waiting, FALSE))
+        {
+            LockMutex(&pad->emergencyQueueMutex);
+            WakePad(pad);
+            UnlockMutex(&pad->emergencyQueueMutex);
+            return;
+        }
+    }
+}
+
+// hand the head of an intake queue to the pad the tower picked for it, FALSE if the pad queue is full
+// or there is no pad (NULL)
+int DispatchToPad(Queue *from, Pad *pad)
+{
+    if (pad == NULL)
+    {
+        return FALSE;
+    }
+    long duration = from->head->data.duration - from->head->data.served;
+
+    LockMutex(&pad->queueMutex);
+    int dispatched = DispatchJob(from, pad->queue);
+    UnlockMutex(&pad->queueMutex);
+
+    if (dispatched)
+    {
+        Assigned(pad, duration);
+        // an idle pad starts the job now, not when it polls its queue again
+        if (atomic_exchange(&pad->waiting, FALSE))
+        {
+            LockMutex(&pad->emergencyQueueMutex);
+            WakePad(pad);
+            UnlockMutex(&pad->emergencyQueueMutex);
+        }
+    }
+    return dispatched;
+}
+
+// the tower gave the pad duration ms more work. Every job counts at least a millisecond, so zero-duration
+// jobs are spread over the pads too.
+void Assigned(Pad *pad, long duration)
+{
+    long now = CurrentMillis();
+    pad->projectedFinish = (pad->projectedFinish > now ? pad->projectedFinish : now) + (duration > 0 ? duration : 1);
+}
+
+// add an outage window of the pad, in ms since start
+int AddOutage(Pad *pad, long start, long end)
+{
+    if (start < 0 || end <= start)
+    {
+        return FALSE;
+    }
+    outages = (Outage *)realloc(outages, (outageCount + 1) * sizeof(Outage));
+    outages[outageCount++] = (Outage){pad, start, end, 0, 0};
+    return TRUE;
+}
+
+// apply an --outage spec, pad name = start seconds + length seconds
+int ParseOutage(const char *spec)
+{
+    const char *equals = strchr(spec, '=');
+    double start, length;
+    if (equals == NULL || sscanf(equals + 1, "%lf+%lf", &start, &length) != 2)
+    {
+        return FALSE;
+    }
+    for (int i = 0; i < padCount; i++)
+    {
+        if (strlen(pads[i].name) == (size_t)(equals - spec) && !strncmp(spec, pads[i].name, equals - spec))
+        {
+            return AddOutage(&pads[i], lround(start * 1000), lround((start + length) * 1000));
+        }
+    }
+    return FALSE;
+}
+
+// start and end the outage windows of the shard's pads that are due, and find when the next one is
+void ProcessOutages(Shard *shard, long now)
+{
+    long next = LONG_MAX;
+    for (int k = 0; k < outageCount; k++)
+    {
+        Outage *outage = &outages[k];
+        Pad *pad = outage->pad;
+        if (pad->index % towerCount != shard->index)
+        {
+            continue;
+        }
+        if (outage->state == 0 && now >= outage->start)
+        {
+            outage->state = 1;
+            outage->stranded = atomic_load(&pad->stranded);
+            if (pad->outages++ == 0 && !pad->parked)
+            {
+                PadDown(pad);
+            }
+        }
+        if (outage->state == 1 && now >= outage->end)
+        {
+            outage->state = 2;
+            outage->stranded = atomic_load(&pad->stranded) - outage->stranded;
+            if (--pad->outages == 0 && !pad->parked)
+            {
+                PadUp(shard, pad);
+            }
+        }
+        if (outage->state < 2 && (outage->state == 0 ? outage->start : outage->end) < next)
+        {
+            next = outage->state == 0 ? outage->start : outage->end;
+        }
+    }
+    shard->nextOutageEvent = next;
+}
+
+// take a pad out of service: the tower stops giving it work and wakes it to hand its jobs back
+void PadDown(Pad *pad)
+{
+    atomic_store(&pad->down, TRUE);
+    pad->projectedFinish = LONG_MAX / 2; // sinks to the bottom of the pad indexes
+
+    LockMutex(&pad->emergencyQueueMutex);
+    WakePad(pad);
+    UnlockMutex(&pad->emergencyQueueMutex);
+}
+
+// put a pad back in service, it is free right away
+void PadUp(Shard *shard, Pad *pad)
+{
+    pad->projectedFinish = CurrentMillis();
+
+    // the only time a projected finish goes back, so the pad indexes are rebuilt instead of fixed lazily
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        PadIndex *index = &shard->capable[type];
+        int count = index->count;
+        index->count = 0;
+        for (int i = 0; i < count; i++)
+        {
+            PadIndexAdd(index, index->pads[i]);
+        }
+    }
+
+    atomic_store(&pad->down, FALSE);
+    LockMutex(&pad->emergencyQueueMutex);
+    WakePad(pad);
+    UnlockMutex(&pad->emergencyQueueMutex);
+}
+
+// whether every job type has a pad of the shard that is not parked (and not the given one) to serve it
+int CoversAllTypes(Shard *shard, Pad *except)
+{
+    unsigned covered = 0;
+    for (int k = 0; k < shard->padCount; k++)
+    {
+        if (!shard->pads[k]->parked && shard->pads[k] != except)
+        {
+            covered |= shard->pads[k]->capabilities;
+        }
+    }
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        if (!(covered & TYPE_MASK(type)))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// --autoscale: activate the shard's first parked pad when the backlog (or the longest predicted wait) is
+// above scaleUp, park its last active one when it is below scaleDown. The gap between the two and the hold
+// after every change keep it from flapping.
+void Autoscale(Shard *shard, long now)
+{
+    shard->nextScaleCheck = now + SCALE_CHECK_MILLIS;
+    if (now - shard->lastScale < scaleHold)
+    {
+        return;
+    }
+
+    // the signals are read from the lock free queue durations
+    long signal = 0;
+    if (scaleOnWait)
+    {
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            long wait = PredictedWait(shard, type);
+            signal = wait > signal ? wait : signal;
+        }
+    }
+    else
+    {
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            signal += QueueDuration(shard->queues[type]);
+        }
+        for (int k = 0; k < shard->padCount; k++)
+        {
+            signal += QueueDuration(shard->pads[k]->queue) + QueueDuration(shard->pads[k]->emergencyQueue);
+        }
+        signal /= shard->activePads;
+    }
+
+    if (signal > scaleUp)
+    {
+        for (int k = 0; k < shard->padCount; k++)
+        {
+            if (shard->pads[k]->parked)
+            {
+                SetParked(shard, shard->pads[k], FALSE);
+                atomic_fetch_add(&scaleUps, 1);
+                shard->lastScale = now;
+                return;
+            }
+        }
+    }
+    else if (signal < scaleDown && shard->activePads > shard->minPads)
+    {
+        for (int k = shard->padCount - 1; k >= 0; k--)
+        {
+            if (!shard->pads[k]->parked && CoversAllTypes(shard, shard->pads[k]))
+            {
+                SetParked(shard, shard->pads[k], TRUE);
+                atomic_fetch_add(&scaleDowns, 1);
+                shard->lastScale = now;
+                return;
+            }
+        }
+    }
+}
+
+// park a pad or put it back in service. A parked pad is down like a pad in an outage, it hands its queued
+// jobs back; one in an outage stays down until the outage ends.
+void SetParked(Shard *shard, Pad *pad, int parked)
+{
+    pad->parked = parked;
+    if (pad->outages == 0)
+    {
+        if (parked)
+        {
+            PadDown(pad);
+        }
+        else
+        {
+            PadUp(shard, pad);
+        }
+    }
+
+    shard->activePads += parked ? -1 : 1;
+    LockMutex(&scaleMutex);
+    long now = CurrentMillis();
+    scaleMillis[activePads] += now - scaleSince;
+    scaleSince = now;
+    activePads += parked ? -1 : 1;
+    UnlockMutex(&scaleMutex);
+}
+
+// a pad that went down moves its queued jobs to its tower's mailbox, the tower dispatches them again. The job
+// it was serving keeps the part served so far. Returns FALSE if the mailbox ran out of room before it was done.
+int HandOver(Pad *pad)
+{
+    Mailbox *mailbox = shards[pad->index % towerCount].mailbox;
+    int done = TRUE;
+
+    LockMutex(&pad->emergencyQueueMutex);
+    while (!isEmpty(pad->emergencyQueue) && (done = MailboxPush(mailbox, pad->emergencyQueue->head->data)))
+    {
+        Dequeue(pad->emergencyQueue);
+        atomic_fetch_add(&pad->stranded, 1);
+    }
+    pad->busyUntil = pad->segmentStart;
+    UnlockMutex(&pad->emergencyQueueMutex);
+
+    LockMutex(&pad->queueMutex);
+    while (done && !isEmpty(pad->queue) && (done = MailboxPush(mailbox, pad->queue->head->data)))
+    {
+        Dequeue(pad->queue);
+        atomic_fetch_add(&pad->stranded, 1);
+    }
+    UnlockMutex(&pad->queueMutex);
+
+    return done;
+}
+
+// take the jobs handed to the shard's tower: landings migrated from other shards join its landing queue,
+// jobs stranded on its pads that went down (they were dispatched before) are dispatched again. Stops at
+// the first job there is no room for, it is tried again on the next pass.
+void DrainMailbox(Shard *shard)
+{
+    Job *j;
+    while ((j = MailboxPeek(shard->mailbox)) != NULL)
+    {
+        if (j->dispatchedAt < 0)
+        {
+            LockMutex(shard->mutexes[LANDING_JOB]);
+            int enqueued = Enqueue(shard->queues[LANDING_JOB], *j);
+            UnlockMutex(shard->mutexes[LANDING_JOB]);
+            if (!enqueued)
+            {
+                return;
+            }
+            atomic_fetch_add(&shard->migratedIn, 1);
+        }
+        else if (!Redispatch(shard, *j))
+        {
+            return;
+        }
+        MailboxPop(shard->mailbox, j);
+    }
+}
+
+// place a job stranded on a pad that went down: on the pad that is up the tower would pick for it, else (or
+// with pull dispatch) back in its intake queue. FALSE if there is no room.
+int Redispatch(Shard *shard, Job j)
+{
+    long duration = j.duration - j.served;
+    if (j.type == EMERGENCY_JOB)
+    {
+        Pad *pad = EarliestAvailablePad(shard);
+        if (pad != NULL)
+        {
+            LockMutex(&pad->emergencyQueueMutex);
+            int enqueued = Enqueue(pad->emergencyQueue, j);
+            WakePad(pad);
+            UnlockMutex(&pad->emergencyQueueMutex);
+            if (enqueued)
+            {
+                Assigned(pad, duration);
+                return TRUE;
+            }
+        }
+    }
+    else if (!pullDispatch)
+    {
+        Pad *pad = NextPadFor(shard, j.type);
+        if (pad != NULL)
+        {
+            LockMutex(&pad->queueMutex);
+            int enqueued = Enqueue(pad->queue, j);
+            UnlockMutex(&pad->queueMutex);
+            if (enqueued)
+            {
+                Assigned(pad, duration);
+                return TRUE;
+            }
+        }
+    }
+
+    LockMutex(shard->mutexes[j.type]);
+    int enqueued = Enqueue(shard->queues[j.type], j);
+    UnlockMutex(shard->mutexes[j.type]);
+    if (enqueued && pullDispatch)
+    {
+        WakeReadyPad(shard, j.type);
+    }
+    return enqueued;
+}
+
+// move the head of an intake queue to a pad queue, the job stays in the intake queue if the pad queue is full
+int DispatchJob(Queue *from, Queue *to)
+{
+    if (isFull(to))
+    {
+        return FALSE;
+    }
+    Enqueue(to, Dispatched(Dequeue(from)));
+    return TRUE;
+}
+
+// the pad an emergency job can start on the earliest. Emergencies preempt regular jobs, so a pad is
+// available as soon as the emergencies already handed to it are done. Ties go to the pad with the
+// least time left on its current job, so idle pads are preferred over preempting a busy one.
+// NULL if every pad that serves emergencies is down.
+Pad *EarliestAvailablePad(Shard *shard)
+{
+    long now = CurrentMillis();
+    Pad *best = NULL;
+    long bestAvailable = 0;
+    long bestRemaining = 0;
+
+    PadIndex *index = &shard->capable[EMERGENCY_JOB];
+    for (int i = 0; i < index->count; i++)
+    {
+        Pad *pad = index->pads[i];
+        if (atomic_load(&pad->down))
+        {
+            continue;
+        }
+
+        LockMutex(&pad->emergencyQueueMutex);
+        long remaining = pad->busyUntil > now ? pad->busyUntil - now : 0;
+        long available = pad->emergencyQueue->duration;
+        if (pad->busyEmergency)
+        {
+            // the head of the emergency queue is being served, only its remaining time counts
+            available += remaining - pad->emergencyQueue->head->data.duration;
+        }
+        UnlockMutex(&pad->emergencyQueueMutex);
+
+        if (best == NULL || available < bestAvailable || (available == bestAvailable && remaining < bestRemaining))
+        {
+            best = pad;
+            bestAvailable = available;
+            bestRemaining = remaining;
+        }
+    }
+
+    return best;
+}
+
+// the pad of the shard that can serve the type with the smallest total duration left in its queue.
+// For threads other than the tower, which picks pads with NextPadFor: it only reads the shard's fixed pad list
+// and the atomic queue durations and down flags.
+Pad *LeastLoadedPad(Shard *shard, int type)
+{
+    Pad *best = NULL, *first = NULL;
+    int bestDuration = 0;
+
+    // the shard's pads and their capabilities never change, unlike the tower's pad indexes
+    for (int i = 0; i < shard->padCount; i++)
+    {
+        Pad *pad = shard->pads[i];
+        if (!PadCanServe(pad, type))
+        {
+            continue;
+        }
+        if (first == NULL)
+        {
+            first = pad;
+        }
+        if (atomic_load(&pad->down))
+        {
+            continue;
+        }
+        int duration = QueueDuration(pad->queue); // lock free, only the tower adds to pad queues
+
+        if (best == NULL || duration < bestDuration)
+        {
+            best = pad;
+            bestDuration = duration;
+        }
+    }
+
+    return best != NULL ? best : first;
+}
+
+static void PadIndexSwap(PadIndex *index, int a, int b)
+{
+    Pad *pad = index->pads[a];
+    long key = index->keys[a];
+    index->pads[a] = index->pads[b];
+    index->keys[a] = index->keys[b];
+    index->pads[b] = pad;
+    index->keys[b] = key;
+}
+
+void PadIndexAdd(PadIndex *index, Pad *pad)
+{
+    int i = index->count++;
+    index->pads[i] = pad;
+    index->keys[i] = pad->projectedFinish;
+    while (i > 0 && index->keys[(i - 1) / 2] > index->keys[i])
+    {
+        PadIndexSwap(index, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+// the pad of the shard that can serve the type and is projected to be done with its work first, for the
+// tower only. O(log N) per pad the tower gave work to since it was last on top. NULL if all of them are
+// down, they sink to the bottom when they go down.
+Pad *NextPadFor(Shard *shard, int type)
+{
+    PadIndex *index = &shard->capable[type];
+    while (index->keys[0] != index->pads[0]->projectedFinish)
+    {
+        index->keys[0] = index->pads[0]->projectedFinish;
+        for (int i = 0;;)
+        {
+            int smallest = i;
+            int left = 2 * i + 1;
+            int right = 2 * i + 2;
+            if (left < index->count && index->keys[left] < index->keys[smallest])
+            {
+                smallest = left;
+            }
+            if (right < index->count && index->keys[right] < index->keys[smallest])
+            {
+                smallest = right;
+            }
+            if (smallest == i)
+            {
+                break;
+            }
+            PadIndexSwap(index, i, smallest);
+            i = smallest;
+        }
+    }
+    return atomic_load(&index->pads[0]->down) ? NULL : index->pads[0];
+}
+
+// the function that controls the air traffic
+void *ControlTower(void *arg)
+{
+    Shard *shard = (Shard *)arg;
+    TraceThread(shard->threadName);
+
+    Queue *emergencies = shard->queues[EMERGENCY_JOB];
+    Queue *landings = shard->queues[LANDING_JOB];
+    Queue *launches = shard->queues[LAUNCH_JOB];
+    Queue *assemblies = shard->queues[ASSEMBLY_JOB];
+    pthread_mutex_t *emergenciesMutex = shard->mutexes[EMERGENCY_JOB];
+    pthread_mutex_t *landingsMutex = shard->mutexes[LANDING_JOB];
+    pthread_mutex_t *launchesMutex = shard->mutexes[LAUNCH_JOB];
+    pthread_mutex_t *assembliesMutex = shard->mutexes[ASSEMBLY_JOB];
+
+    while (SimulationRunning())
+    {
+        if (CurrentMillis() >= shard->nextOutageEvent)
+        {
+            ProcessOutages(shard, CurrentMillis());
+        }
+        if (scaleMax > 0 && CurrentMillis() >= shard->nextScaleCheck)
+        {
+            Autoscale(shard, CurrentMillis());
+        }
+        if (towerCount > 1)
+        {
+            atomic_store(&shard->load, ShardLoad(shard));
+        }
+        if (!MailboxEmpty(shard->mailbox))
+        {
+            DrainMailbox(shard);
+        }
+        if (ingestName != NULL && shard->index == 0 && ArrivalsOpen())
+        {
+            IngestJobs();
+        }
+
+        // nothing to dispatch, check again without taking any lock (only this thread dequeues from these queues,
+        // with pull dispatch the pads take the regular jobs themselves)
+        if (QueueSize(emergencies) == 0 && (pullDispatch || (QueueSize(landings) == 0 && QueueSize(launches) == 0 && QueueSize(assemblies) == 0)))
+        {
+            continue;
+        }
+
+        LockMutex(emergenciesMutex);
+
+        // give every waiting emergency job to the pad that can start it the earliest
+        while (QueueSize(emergencies) > 0)
+        {
+            Pad *pad = EarliestAvailablePad(shard);
+            if (pad == NULL) // every pad that can take it is down
+            {
+                break;
+            }
+
+            LockMutex(&pad->emergencyQueueMutex);
+
+            long duration = emergencies->head->data.duration;
+            int dispatched = DispatchJob(emergencies, pad->emergencyQueue);
+            WakePad(pad); // preempt the job the pad is working on
+
+            UnlockMutex(&pad->emergencyQueueMutex);
+            if (!dispatched)
+            {
+                break;
+            }
+            Assigned(pad, duration); // the pad's queued work is pushed back by the emergency
+        }
+
+        UnlockMutex(emergenciesMutex);
+
+        if (pullDispatch)
+        {
+            continue;
+        }
+
+        LockMutex(launchesMutex);
+        LockMutex(assembliesMutex);
+
+        // if the launch and assembly queue has less than 3 jobs, then empty the landing queue
+        if (QueueSize(launches) < 3 && QueueSize(assemblies) < 3)
+        {
+            UnlockMutex(launchesMutex);
+            UnlockMutex(assembliesMutex);
+
+            LockMutex(landingsMutex);
+
+            // empty the landing queue
+            while (!isEmpty(landings))
+            {
+                if (!DispatchLanding(shard))
+                {
+                    break;
+                }
+            }
+
+            UnlockMutex(landingsMutex);
+
+            LockMutex(launchesMutex);
+
+            if (!isEmpty(launches))
+            {
+                DispatchToPad(launches, NextPadFor(shard, LAUNCH_JOB));
+            }
+
+            UnlockMutex(launchesMutex);
+
+            LockMutex(assembliesMutex);
+
+            if (!isEmpty(assemblies))
+            {
+                DispatchToPad(assemblies, NextPadFor(shard, ASSEMBLY_JOB));
+            }
+
+            UnlockMutex(assembliesMutex);
+        }
+        else // Take one job from each queue
+        {
+            // if the launch queue is not empty, take its first job and put it on the next pad that launches
+            if (!isEmpty(launches))
+            {
+                DispatchToPad(launches, NextPadFor(shard, LAUNCH_JOB));
+            }
+
+            UnlockMutex(launchesMutex);
+
+            // if the assembly queue is not empty, take its first job and put it on the next pad that assembles
+            if (!isEmpty(assemblies))
+            {
+                DispatchToPad(assemblies, NextPadFor(shard, ASSEMBLY_JOB));
+            }
+
+            UnlockMutex(assembliesMutex);
+
+            // if the landing queue is not empty, take its first job and put it in the shortest pad
+            LockMutex(landingsMutex);
+            if (!isEmpty(landings))
+            {
+                DispatchLanding(shard);
+            }
+            UnlockMutex(landingsMutex);
+        }
+    }
+
+    return NULL;
+}
+
+// the events that end the pad's sleep on its current segment early
+int PadWakeEvents(Pad *pad)
+{
+    switch (pad->segment)
+    {
+    case SEGMENT_JOB:
+        return finishInFlight ? WAKE_ON_EMERGENCY | WAKE_ON_DOWN : WAKE_ON_EMERGENCY | WAKE_ON_SHUTDOWN | WAKE_ON_DOWN;
+    case SEGMENT_EMERGENCY: // emergencies are never preempted, not even by an outage
+        return finishInFlight ? 0 : WAKE_ON_SHUTDOWN;
+    case SEGMENT_OUTAGE:
+        return WAKE_ON_UP | WAKE_ON_SHUTDOWN;
+    default:
+        return pullDispatch ? WAKE_ON_EMERGENCY | WAKE_ON_SHUTDOWN | WAKE_ON_DOWN | WAKE_ON_READY
+                            : WAKE_ON_EMERGENCY | WAKE_ON_SHUTDOWN | WAKE_ON_DOWN | WAKE_ON_QUEUED;
+    }
+}
+
+// wake the pad up before its current segment ends, called with the pad's emergencyQueueMutex held
+void WakePad(Pad *pad)
+{
+    pthread_cond_signal(&pad->emergencyCond);
+    if (workerCount > 0)
+    {
+        ExecutorWake(&pad->task);
+    }
+}
+
+// start the pad's next segment: an emergency job first, then the head of the pad queue, else idle
+// returns the length of the segment in milliseconds
+int PadStartSegment(Pad *pad)
+{
+    pad->segmentStart = CurrentMillis();
+    pad->traceStart = TraceNow();
+    atomic_store(&pad->waiting, FALSE);
+
+    // a pad that is down hands its jobs back to the tower, then waits until it is up again
+    if (atomic_load(&pad->down))
+    {
+        pad->segment = SEGMENT_OUTAGE;
+        pad->segmentLength = HandOver(pad) ? idleMillis : BLOCK_RETRY_MILLIS;
+        return pad->segmentLength;
+    }
+
+    // if there is a emergency job, then do it immediately
+    LockMutex(&pad->emergencyQueueMutex);
+    if (!isEmpty(pad->emergencyQueue))
+    {
+        pad->emergencyQueue->head->data.startedAt = pad->segmentStart;
+        pad->current = pad->emergencyQueue->head->data;
+        pad->segment = SEGMENT_EMERGENCY;
+        pad->segmentLength = pad->current.duration - pad->current.served; // served is only set by a checkpoint
+        pad->busyUntil = pad->segmentStart + pad->segmentLength;
+        pad->busyEmergency = TRUE;
+        UnlockMutex(&pad->emergencyQueueMutex);
+        return pad->segmentLength;
+    }
+    UnlockMutex(&pad->emergencyQueueMutex);
+
+    // with pull dispatch the pad queue only holds the job being served (or a preempted one), a free pad
+    // takes its next job now (lock free check, only this pad adds to its queue)
+    if (pullDispatch && QueueSize(pad->queue) == 0)
+    {
+        PullJob(pad);
+    }
+
+    // if there is no job in the pad queue, then sleep for UNIT_TIME seconds, or until an emergency job arrives
+    LockMutex(&pad->queueMutex);
+    if (isEmpty(pad->queue))
+    {
+        UnlockMutex(&pad->queueMutex);
+        pad->segment = SEGMENT_IDLE;
+        pad->segmentLength = idleMillis;
+        // a job that arrived since PullJob looked, or that the tower gave the pad since its queue was
+        // checked, found the pad not waiting, and nobody woke it
+        atomic_store(&pad->waiting, TRUE);
+        if (pullDispatch ? HasReadyJob(pad) : QueueSize(pad->queue) > 0)
+        {
+            pad->segmentLength = 0;
+        }
+        return pad->segmentLength;
+    }
+
+    // do the job, a preempted job is resumed with its remaining duration
+    if (pad->queue->head->data.startedAt < 0)
+    {
+        pad->queue->head->data.startedAt = pad->segmentStart;
+    }
+    pad->current = pad->queue->head->data;
+    UnlockMutex(&pad->queueMutex);
+
+    pad->segment = SEGMENT_JOB;
+    pad->segmentLength = pad->current.duration - pad->current.served;
+
+    LockMutex(&pad->emergencyQueueMutex);
+    pad->busyUntil = pad->segmentStart + pad->segmentLength;
+    UnlockMutex(&pad->emergencyQueueMutex);
+
+    return pad->segmentLength;
+}
+
+// end the pad's current segment after elapsed milliseconds: log a completed job, or account the
+// part of a preempted job that was served, it stays at the head of the queue and is resumed later
+void PadEndSegment(Pad *pad, long elapsed)
+{
+    if (pad->segment == SEGMENT_IDLE || pad->segment == SEGMENT_OUTAGE)
+    {
+        TraceSpan(TRACE_PADS, pad->index, pad->segment == SEGMENT_IDLE ? "idle" : "outage", 0, pad->traceStart);
+        pad->segment = SEGMENT_NONE;
+        return;
+    }
+
+    TraceSpan(TRACE_PADS, pad->index, GetTypeName(pad->current.type), pad->current.ID, pad->traceStart);
+    atomic_fetch_add(&pad->busyMillis, elapsed);
+
+    Job j;
+    if (pad->segment == SEGMENT_EMERGENCY)
+    {
+        LockMutex(&pad->emergencyQueueMutex);
+        j = Dequeue(pad->emergencyQueue);
+        pad->busyEmergency = FALSE;
+        UnlockMutex(&pad->emergencyQueueMutex);
+    }
+    else if (elapsed < pad->segmentLength) // preempted by an emergency or an outage
+    {
+        LockMutex(&pad->queueMutex);
+        pad->queue->head->data.served += elapsed;
+        UnlockMutex(&pad->queueMutex);
+        pad->segment = SEGMENT_NONE;
+        return;
+    }
+    else
+    {
+        LockMutex(&pad->queueMutex);
+        j = Dequeue(pad->queue);
+        UnlockMutex(&pad->queueMutex);
+    }
+
+    // Job is done
+    j.completedAt = CurrentMillis();
+    atomic_fetch_sub(&jobsInSystem, 1);
+    atomic_fetch_add(&pad->jobsServed, 1);
+    atomic_fetch_add(&pad->typeJobs[j.type], 1);
+    pad->segment = SEGMENT_NONE;
+
+    // Write the job to the log file
+    WriteLog(j, pad);
+}
+
+// end the pad's current segment if it is over (or preempted) and start the next one
+// returns the milliseconds until the pad has to step again
+int PadStep(Pad *pad)
+{
+    if (pad->segment != SEGMENT_NONE)
+    {
+        long elapsed = CurrentMillis() - pad->segmentStart;
+        if (elapsed > pad->segmentLength)
+        {
+            elapsed = pad->segmentLength;
+        }
+        // woken up during an emergency, which can't be preempted, so keep landing it
+        if (pad->segment == SEGMENT_EMERGENCY && elapsed < pad->segmentLength)
+        {
+            return pad->segmentLength - elapsed;
+        }
+        PadEndSegment(pad, elapsed);
+    }
+
+    int length = PadStartSegment(pad);
+    PadAccount(pad, pad->segment == SEGMENT_IDLE ? JOB_TYPE_END : pad->segment == SEGMENT_OUTAGE ? JOB_TYPE_END + 1 : pad->current.type);
+    return length;
+}
+
+void *LaunchPad(void *arg)
+{
+    Pad *pad = (Pad *)arg;
+    TraceThread(pad->threadName);
+    jitterRole = JITTER_PADS;
+
+    while (SimulationRunning())
+    {
+        int sleepTime = PadStep(pad);
+        PadSleep(pad, sleepTime, PadWakeEvents(pad));
+    }
+
+    // with --finish-inflight, complete the job that was being served when the simulation ended
+    while (finishInFlight && (pad->segment == SEGMENT_JOB || pad->segment == SEGMENT_EMERGENCY))
+    {
+        long remaining = pad->segmentStart + pad->segmentLength - CurrentMillis();
+        if (remaining > 0)
+        {
+            PadSleep(pad, remaining, 0);
+            continue;
+        }
+        PadEndSegment(pad, pad->segmentLength);
+    }
+
+    return NULL;
+}
+
+// a pad in the M:N mode, runs the same steps as a LaunchPad thread
+long PadTask(Task *task)
+{
+    if (!SimulationRunning())
+    {
+        return -1;
+    }
+    return PadStep((Pad *)task->arg);
+}
+
+// a producer in the M:N mode, each step is one iteration of ProducerThread
+long ProducerTask(Task *task)
+{
+    if (!ArrivalsOpen())
+    {
+        return -1;
+    }
+
+    return ProducerStep((Producer *)task->arg);
+}
+
+// Write the job to the log buffer of the pad's shard, which goes to the log file once it is full
+void *WriteLog(Job j, Pad *pad)
+{
+    // Create log string
+    time_t end_time = time(NULL) - simulationStartTime;
+    char log[160];
+    int length = sprintf(log, "%-20" PRIu64 " %5c %11d %13ld %11ld %10s %12.3f %12.3f %12.3f\n", j.ID, GetType(j.type), j.arrivalTime, end_time, end_time - j.arrivalTime, pad->name,
+            (j.dispatchedAt - j.createdAt) / 1000.0, (j.startedAt - j.dispatchedAt) / 1000.0, (j.completedAt - j.startedAt) / 1000.0);
+
+    atomic_fetch_add(&completedJobs[j.type], 1);
+    HistogramAdd(&turnaroundHistogram, end_time - j.arrivalTime);
+    atomic_fetch_add(&waitMillis[j.type], j.startedAt - j.createdAt);
+    atomic_fetch_add(&sojournMillis[j.type], j.completedAt - j.createdAt);
+    if (timelineJobs != NULL && j.completedAt / 1000 < timelineSeconds)
+    {
+        atomic_fetch_add(&timelineJobs[j.completedAt / 1000], 1);
+        atomic_fetch_add(&timelineTurnaround[j.completedAt / 1000], j.completedAt - j.createdAt);
+    }
+    if (scaleMax > 0)
+    {
+        int active = activePads; // a stale count only files the job under a neighbouring row
+        atomic_fetch_add(&scaleJobs[active], 1);
+        atomic_fetch_add(&scaleTurnaround[active], j.completedAt - j.createdAt);
+    }
+
+    // stress mode measures the tower and queues, not the log file
+    if (stress)
+    {
+        return NULL;
+    }
+
+    // add the log string to the shard's buffer, the pads of other shards never wait for it
+    Shard *shard = &shards[pad->index % towerCount];
+    LockMutex(&shard->logMutex);
+    if (shard->logLength + length > LOG_BUFFER)
+    {
+        FlushLog(shard);
+    }
+    memcpy(shard->log + shard->logLength, log, length);
+    shard->logLength += length;
+    UnlockMutex(&shard->logMutex);
+
+    return NULL;
+}
+
+// append the shard's buffered log lines to the log file, called with its logMutex held or after the pads stopped.
+// O_APPEND keeps the batches of different shards from overwriting each other.
+void FlushLog(Shard *shard)
+{
+    if (shard->logLength > 0 && write(logFd, shard->log, shard->logLength) < 0)
+    {
+        perror("log.txt");
+    }
+    shard->logLength = 0;
+}
+
+// Write the current status of the queues to the console periodically
+void *PrintCurrentQueues(void *arg)
+{
+    TraceThread("PrintCurrentQueues");
+
+    while (SimulationRunning())
+    {
+        // sleep for 1 second
+        pthread_sleep(1);
+
+        int current_time = time(NULL) - simulationStartTime;
+        if (deltaDisplay)
+        {
+            // the journals are swapped every second, so the first print has only the last second's changes
+            PrintQueueChanges(n <= current_time ? current_time : -1);
+            if (n <= current_time && current_time % summaryEvery == 0)
+            {
+                PrintQueueSummary(current_time);
+            }
+        }
+        else if (n <= current_time)
+        {
+            // print the intake queues
+            for (int s = 0, k = 0; s < towerCount; s++)
+            {
+                for (int type = LANDING_JOB; type < JOB_TYPE_END; type++, k++)
+                {
+                    LockMutex(shards[s].mutexes[type]);
+                    printf("At %d sec %s: ", current_time, allQueueNames[k]);
+                    PrintQueue(shards[s].queues[type]);
+                    UnlockMutex(shards[s].mutexes[type]);
+                }
+            }
+
+            // print the pad queues
+            for (int i = 0; i < padCount; i++)
+            {
+                LockMutex(&pads[i].queueMutex);
+                printf("At %d sec pad%s: ", current_time, pads[i].name);
+                PrintQueue(pads[i].queue);
+                UnlockMutex(&pads[i].queueMutex);
+            }
+
+            // print the pad emergency queues
+            for (int i = 0; i < padCount; i++)
+            {
+                LockMutex(&pads[i].emergencyQueueMutex);
+                printf("At %d sec pad%s emergency: ", current_time, pads[i].name);
+                PrintQueue(pads[i].emergencyQueue);
+                UnlockMutex(&pads[i].emergencyQueueMutex);
+            }
+
+            printf("\n");
+        }
+    }
+
+    return NULL;
+}
+
+// the mutex that protects allQueues[k]
+pthread_mutex_t *QueueMutex(int k)
+{
+    int types = JOB_TYPE_END - LANDING_JOB, intakeCount = types * towerCount;
+    if (k < intakeCount)
+    {
+        return shards[k / types].mutexes[LANDING_JOB + k % types];
+    }
+    if (k < intakeCount + padCount)
+    {
+        return &pads[k - intakeCount].queueMutex;
+    }
+    return &pads[k - intakeCount - padCount].emergencyQueueMutex;
+}
+
+// --display delta: take every queue's journal and print the jobs that were enqueued (+) and dequeued (-) since
+// the last call, for the queues that changed. The locks are only held for the swap, so the cost is in
+// proportion to the changes, not to the jobs queued. Nothing is printed for a negative current_time.
+void PrintQueueChanges(int current_time)
+{
+    int printed = FALSE;
+    for (int k = 0; k < allQueueCount; k++)
+    {
+        pthread_mutex_t *mutex = QueueMutex(k);
+        LockMutex(mutex);
+        QueueJournal *journal = SwapJournal(allQueues[k], spareJournals[k]);
+        UnlockMutex(mutex);
+        spareJournals[k] = journal;
+
+        if (current_time < 0 || journal->enqueued + journal->dequeued == 0)
+        {
+            continue;
+        }
+        printf("At %d sec %s:", current_time, allQueueNames[k]);
+        for (int i = 0; i < journal->count; i++)
+        {
+            printf(" %c%" PRIu64, journal->changes[i].change, journal->changes[i].ID);
+        }
+        if (journal->count < journal->enqueued + journal->dequeued)
+        {
+            printf(" ... %ld enqueued and %ld dequeued in all", journal->enqueued, journal->dequeued);
+        }
+        printf("\n");
+        printed = TRUE;
+    }
+    if (printed)
+    {
+        printf("\n");
+    }
+}
+
+// --display delta: the size and queued seconds of every queue on one line, from the lock free counters
+void PrintQueueSummary(int current_time)
+{
+    printf("At %d sec summary:", current_time);
+    for (int k = 0; k < allQueueCount; k++)
+    {
+        printf(" %s %d/%.1fs", allQueueNames[k], QueueSize(allQueues[k]), QueueDuration(allQueues[k]) / 1000.0);
+        printf(k + 1 < allQueueCount ? "," : "\n\n");
+    }
+}
+
+// record the size and duration of every queue periodically, without taking any queue lock
+void *QueueSampler(void *arg)
+{
+    sampleTimes = (long *)malloc(sampleCapacity * sizeof(long));
+    sampleSizes = (int *)malloc(sampleCapacity * allQueueCount * sizeof(int));
+    sampleDurations = (int *)malloc(sampleCapacity * allQueueCount * sizeof(int));
+    sampleCount = 0;
+
+    while (SimulationRunning())
+    {
+        int row = sampleCount % sampleCapacity;
+        sampleTimes[row] = CurrentMillis();
+        for (int i = 0; i < allQueueCount; i++)
+        {
+            sampleSizes[row * allQueueCount + i] = QueueSize(allQueues[i]);
+            sampleDurations[row * allQueueCount + i] = QueueDuration(allQueues[i]);
+        }
+        sampleCount++;
+
+        SleepMillis(sampleInterval);
+    }
+
+    return NULL;
+}
+
+// write the samples in the ring buffer to samples.txt, oldest first
+void DumpSamples()
+{
+    FILE *fp = fopen("samples.txt", "w");
+    fprintf(fp, "Time");
+    for (int i = 0; i < allQueueCount; i++)
+    {
+        fprintf(fp, ", %s size, %s duration", allQueueNames[i], allQueueNames[i]);
+    }
+    fprintf(fp, "\n");
+
+    long first = sampleCount > sampleCapacity ? sampleCount - sampleCapacity : 0;
+    for (long k = first; k < sampleCount; k++)
+    {
+        int row = k % sampleCapacity;
+        fprintf(fp, "%ld", sampleTimes[row]);
+        for (int i = 0; i < allQueueCount; i++)
+        {
+            fprintf(fp, ", %d, %.3f", sampleSizes[row * allQueueCount + i], sampleDurations[row * allQueueCount + i] / 1000.0);
+        }
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+
+    free(sampleTimes);
+    free(sampleSizes);
+    free(sampleDurations);
+}
+
+// called by the pad only: account the ms since the last call to what the pad was doing, the time between
+// two segments included so that the counters add up to the wall time, and start accounting the next segment
+// as the given PadCounters index. The sequence lets readers see both changes or neither.
+void PadAccount(Pad *pad, int next)
+{
+    long now = CurrentMillis();
+    atomic_fetch_add(&pad->accountSequence, 1);
+    int state = atomic_load(&pad->accountState);
+    long elapsed = now - atomic_load(&pad->accountSince);
+    if (state >= LANDING_JOB && state < JOB_TYPE_END)
+    {
+        atomic_fetch_add(&pad->typeMillis[state], elapsed);
+    }
+    else if (state == JOB_TYPE_END || state == JOB_TYPE_END + 1)
+    {
+        atomic_fetch_add(state == JOB_TYPE_END ? &pad->idleMillis : &pad->downMillis, elapsed);
+    }
+    atomic_store(&pad->accountState, next);
+    atomic_store(&pad->accountSince, now);
+    atomic_fetch_add(&pad->accountSequence, 1);
+}
+
+// the pad's accounting at now (ms since start), the segment it is in counted up to then: ms busy per job type, ms idle,
+// ms down and jobs served. Read without a lock, retried if the pad updated it meanwhile.
+void PadCounters(Pad *pad, long now, long *counters)
+{
+    unsigned sequence;
+    int state;
+    long since;
+    do
+    {
+        sequence = atomic_load(&pad->accountSequence);
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            counters[type] = atomic_load(&pad->typeMillis[type]);
+        }
+        counters[JOB_TYPE_END] = atomic_load(&pad->idleMillis);
+        counters[JOB_TYPE_END + 1] = atomic_load(&pad->downMillis);
+        state = atomic_load(&pad->accountState);
+        since = atomic_load(&pad->accountSince);
+    } while ((sequence & 1) || sequence != atomic_load(&pad->accountSequence));
+    counters[JOB_TYPE_END + 2] = atomic_load(&pad->jobsServed);
+
+    if (state >= 0 && now > since)
+    {
+        counters[state] += now - since;
+    }
+}
+
+// add a row of the accounting of every pad to the ring buffer
+static void SnapshotPads()
+{
+    int row = windowCount % sampleCapacity;
+    windowTimes[row] = CurrentMillis();
+    for (int i = 0; i < padCount; i++)
+    {
+        PadCounters(&pads[i], windowTimes[row], &windowCounters[(row * padCount + i) * PAD_COUNTERS]);
+    }
+    windowCount++;
+}
+
+// snapshot the accounting of every pad at the start and at the end of each window, the last one ends at
+// the shutdown
+void *PadWindowSampler(void *arg)
+{
+    windowTimes = (long *)malloc(sampleCapacity * sizeof(long));
+    windowCounters = (long *)malloc(sampleCapacity * padCount * PAD_COUNTERS * sizeof(long));
+    windowCount = 0;
+
+    SnapshotPads();
+    while (SimulationRunning())
+    {
+        SleepMillis(padWindow);
+        SnapshotPads();
+    }
+
+    return NULL;
+}
+
+// write what every pad did in each window to pad_windows.txt, the differences between consecutive snapshots
+void DumpPadWindows()
+{
+    FILE *fp = fopen("pad_windows.txt", "w");
+    fprintf(fp, "Start, End, Pad");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        fprintf(fp, ", %s s", GetTypeName(type));
+    }
+    fprintf(fp, ", idle s, down s, jobs, utilization\n");
+
+    long first = windowCount > sampleCapacity ? windowCount - sampleCapacity : 0;
+    for (long k = first + 1; k < windowCount; k++)
+    {
+        int previous = (k - 1) % sampleCapacity, row = k % sampleCapacity;
+        long length = windowTimes[row] - windowTimes[previous];
+        for (int i = 0; i < padCount; i++)
+        {
+            long *before = &windowCounters[(previous * padCount + i) * PAD_COUNTERS];
+            long *after = &windowCounters[(row * padCount + i) * PAD_COUNTERS];
+            long busy = 0;
+            fprintf(fp, "%ld, %ld, %s", windowTimes[previous], windowTimes[row], pads[i].name);
+            for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+            {
+                busy += after[type] - before[type];
+                fprintf(fp, ", %.3f", (after[type] - before[type]) / 1000.0);
+            }
+            fprintf(fp, ", %.3f, %.3f, %ld, %.3f\n", (after[JOB_TYPE_END] - before[JOB_TYPE_END]) / 1000.0,
+                    (after[JOB_TYPE_END + 1] - before[JOB_TYPE_END + 1]) / 1000.0, after[JOB_TYPE_END + 2] - before[JOB_TYPE_END + 2],
+                    length > 0 ? (double)busy / length : 0.0);
+        }
+    }
+    fclose(fp);
+
+    free(windowTimes);
+    free(windowCounters);
+}
+
+// where every pad's time went and how many jobs it served, to tell an imbalance between the pads from
+// capacity that is not used. A job abandoned at the shutdown counts up to then.
+void PrintPadReport()
+{
+    long span = shutdownMillis - runStartMillis;
+    printf("Pads (seconds by job type, idle and down, of %.1f s)\n", span / 1000.0);
+    printf("%-5s", "Pad");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        printf(" %9s", GetTypeName(type));
+    }
+    printf(" %9s %9s %6s %7s", "idle", "down", "Busy", "Jobs");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        printf(" %6c", GetType(type));
+    }
+    printf("\n");
+
+    for (int i = 0; i < padCount; i++)
+    {
+        long counters[PAD_COUNTERS], busy = 0;
+        PadCounters(&pads[i], shutdownMillis, counters);
+        printf("%-5s", pads[i].name);
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            busy += counters[type];
+            printf(" %9.3f", counters[type] / 1000.0);
+        }
+        printf(" %9.3f %9.3f %5.1f%% %7ld", counters[JOB_TYPE_END] / 1000.0, counters[JOB_TYPE_END + 1] / 1000.0,
+               span > 0 ? 100.0 * busy / span : 0.0, counters[JOB_TYPE_END + 2]);
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            printf(" %6ld", atomic_load(&pads[i].typeJobs[type]));
+        }
+        printf("\n");
+    }
+}
+
+// write a snapshot of the simulation for the metrics server, in compact text or Prometheus format
+void WriteMetrics(FILE *out, int prometheus)
+{
+    long now = CurrentMillis();
+    double quantiles[] = {0.5, 0.9, 0.99};
+    long span = now - runStartMillis; // what busyMillis covers, this run without the restored clock
+    long lockAcquisitions, lockContentions, lockWaitNanos;
+    LockTotals(&lockAcquisitions, &lockContentions, &lockWaitNanos);
+
+    if (prometheus)
+    {
+        fprintf(out, "# TYPE spaceport_uptime_seconds gauge\nspaceport_uptime_seconds %.3f\n", now / 1000.0);
+        fprintf(out, "# TYPE spaceport_queue_size gauge\n");
+        for (int i = 0; i < allQueueCount; i++)
+        {
+            fprintf(out, "spaceport_queue_size{queue=\"%s\"} %d\n", allQueueNames[i], QueueSize(allQueues[i]));
+        }
+        fprintf(out, "# TYPE spaceport_queue_duration_seconds gauge\n");
+        for (int i = 0; i < allQueueCount; i++)
+        {
+            fprintf(out, "spaceport_queue_duration_seconds{queue=\"%s\"} %.3f\n", allQueueNames[i], QueueDuration(allQueues[i]) / 1000.0);
+        }
+        fprintf(out, "# TYPE spaceport_pad_busy_seconds_total counter\n");
+        for (int i = 0; i < padCount; i++)
+        {
+            fprintf(out, "spaceport_pad_busy_seconds_total{pad=\"%s\"} %.3f\n", pads[i].name, atomic_load(&pads[i].busyMillis) / 1000.0);
+        }
+        fprintf(out, "# TYPE spaceport_pad_seconds_total counter\n");
+        for (int i = 0; i < padCount; i++)
+        {
+            long counters[PAD_COUNTERS];
+            PadCounters(&pads[i], now, counters);
+            for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+            {
+                fprintf(out, "spaceport_pad_seconds_total{pad=\"%s\",state=\"%s\"} %.3f\n", pads[i].name, GetTypeName(type), counters[type] / 1000.0);
+            }
+            fprintf(out, "spaceport_pad_seconds_total{pad=\"%s\",state=\"idle\"} %.3f\n", pads[i].name, counters[JOB_TYPE_END] / 1000.0);
+            fprintf(out, "spaceport_pad_seconds_total{pad=\"%s\",state=\"down\"} %.3f\n", pads[i].name, counters[JOB_TYPE_END + 1] / 1000.0);
+        }
+        fprintf(out, "# TYPE spaceport_pad_utilization gauge\n");
+        for (int i = 0; i < padCount; i++)
+        {
+            fprintf(out, "spaceport_pad_utilization{pad=\"%s\"} %.4f\n", pads[i].name, span > 0 ? (double)atomic_load(&pads[i].busyMillis) / span : 0.0);
+        }
+        fprintf(out, "# TYPE spaceport_pad_jobs_total counter\n");
+        for (int i = 0; i < padCount; i++)
+        {
+            fprintf(out, "spaceport_pad_jobs_total{pad=\"%s\"} %ld\n", pads[i].name, atomic_load(&pads[i].jobsServed));
+        }
+        fprintf(out, "# TYPE spaceport_jobs_completed_total counter\n");
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            fprintf(out, "spaceport_jobs_completed_total{type=\"%c\"} %ld\n", GetType(type), atomic_load(&completedJobs[type]));
+        }
+        fprintf(out, "# TYPE spaceport_jobs_dropped_total counter\n");
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            fprintf(out, "spaceport_jobs_dropped_total{type=\"%c\"} %ld\n", GetType(type), atomic_load(&droppedJobs[type]));
+        }
+        fprintf(out, "# TYPE spaceport_jobs_rejected_total counter\n");
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+        {
+            fprintf(out, "spaceport_jobs_rejected_total{type=\"%c\"} %ld\n", GetType(type), atomic_load(&rejectedJobs[type]));
+        }
+        fprintf(out, "# TYPE spaceport_turnaround_seconds summary\n");
+        for (int i = 0; i < 3; i++)
+        {
+            fprintf(out, "spaceport_turnaround_seconds{quantile=\"%g\"} %ld\n", quantiles[i], HistogramPercentile(&turnaroundHistogram, quantiles[i]));
+        }
+        fprintf(out, "spaceport_turnaround_seconds_sum %ld\n", atomic_load(&turnaroundHistogram.sum));
+        fprintf(out, "spaceport_turnaround_seconds_count %ld\n", atomic_load(&turnaroundHistogram.total));
+        fprintf(out, "# TYPE spaceport_lock_acquisitions_total counter\nspaceport_lock_acquisitions_total %ld\n", lockAcquisitions);
+        fprintf(out, "# TYPE spaceport_lock_contentions_total counter\nspaceport_lock_contentions_total %ld\n", lockContentions);
+        fprintf(out, "# TYPE spaceport_lock_wait_seconds_total counter\nspaceport_lock_wait_seconds_total %.6f\n", lockWaitNanos / 1e9);
+        return;
+    }
+
+    fprintf(out, "uptime %.3f s\n", now / 1000.0);
+    for (int i = 0; i < allQueueCount; i++)
     {
-        // sleep for UNIT_TIME seconds
-        pthread_sleep(UNIT_TIME);
-
-        // create a landing job with probability 1-p
-        if (rand() % 100 < 100 - p * 100)
+        fprintf(out, "queue %s size %d duration %.3f\n", allQueueNames[i], QueueSize(allQueues[i]), QueueDuration(allQueues[i]) / 1000.0);
+    }
+    for (int i = 0; i < padCount; i++)
+    {
+        long busy = atomic_load(&pads[i].busyMillis);
+        fprintf(out, "pad %s busy %.3f s utilization %.1f%% jobs %ld idle %.3f s down %.3f s", pads[i].name, busy / 1000.0, span > 0 ? 100.0 * busy / span : 0.0,
+                atomic_load(&pads[i].jobsServed), atomic_load(&pads[i].idleMillis) / 1000.0, atomic_load(&pads[i].downMillis) / 1000.0);
+        for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
         {
-            Job j;
-            j.ID = rand() % 1000;
-            j.type = LANDING_JOB;
-            j.duration = LANDING_JOB_DURATION;
-            j.arrivalTime = time(NULL) - simulationStartTime;
-
-            pthread_mutex_lock(&landingQueueMutex);
-
-            Enqueue(landingQueue, j);
-
-            pthread_mutex_unlock(&landingQueueMutex);
+            fprintf(out, " %c %.3f s", GetType(type), atomic_load(&pads[i].typeMillis[type]) / 1000.0);
         }
+        fprintf(out, "\n");
     }
-
-    return NULL;
+    fprintf(out, "completed");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        fprintf(out, " %c %ld", GetType(type), atomic_load(&completedJobs[type]));
+    }
+    fprintf(out, "\ndropped");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        fprintf(out, " %c %ld", GetType(type), atomic_load(&droppedJobs[type]));
+    }
+    fprintf(out, "\nrejected");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        fprintf(out, " %c %ld", GetType(type), atomic_load(&rejectedJobs[type]));
+    }
+    fprintf(out, "\nturnaround p50 %ld p90 %ld p99 %ld s\n", HistogramPercentile(&turnaroundHistogram, 0.5), HistogramPercentile(&turnaroundHistogram, 0.9), HistogramPercentile(&turnaroundHistogram, 0.99));
+    fprintf(out, "locks acquired %ld contended %ld wait %.3f ms\n", lockAcquisitions, lockContentions, lockWaitNanos / 1e6);
 }
 
-// the function that creates plane threads for departure
-void *LaunchJob(void *arg)
+// what the overload policies did, printed when any of them had to act
+void PrintOverloadReport()
 {
-    while (time(NULL) < deadline)
+    const char *policies[] = {"drop-newest", "drop-oldest", "block", "reject"};
+    long total = 0;
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
     {
-        // sleep for UNIT_TIME seconds
-        pthread_sleep(UNIT_TIME);
-
-        // create a landing job with probability p/2
-        if (rand() % 100 < (p / 2) * 100)
+        total += atomic_load(&droppedJobs[type]) + atomic_load(&rejectedJobs[type]) + atomic_load(&blockedJobs[type]);
+    }
+    if (total == 0)
+    {
+        return;
+    }
+    // producers still blocked at the end
+    for (int i = 0; i < allProducerCount; i++)
+    {
+        if (producers[i].blocked > 0)
         {
-            Job j;
-            j.ID = rand() % 1000;
-            j.type = LAUNCH_JOB;
-            j.duration = LAUNCH_JOB_DURATION;
-            j.arrivalTime = time(NULL) - simulationStartTime;
-
-            pthread_mutex_lock(&launchQueueMutex);
-
-            Enqueue(launchQueue, j);
-
-            pthread_mutex_unlock(&launchQueueMutex);
+            atomic_fetch_add(&blockedMillis[producers[i].type], shutdownMillis - producers[i].blockedSince);
         }
     }
 
-    return NULL;
+    printf("Overload (queues of %d jobs)\n", queueLimit);
+    printf("%-10s %-12s %10s %10s %10s %12s\n", "Type", "Policy", "Dropped", "Rejected", "Blocked", "Blocked s");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        printf("%-10s %-12s %10ld %10ld %10ld %12.3f\n", GetTypeName(type), policies[jobTypes[type].overload], atomic_load(&droppedJobs[type]),
+               atomic_load(&rejectedJobs[type]), atomic_load(&blockedJobs[type]), atomic_load(&blockedMillis[type]) / 1000.0);
+    }
 }
 
-// the function that creates plane threads for emergency landing
-void *EmergencyJob(void *arg)
+// jobs completed per second and their mean turnaround in seconds in [from, to) seconds since start
+static void PrintTimelineWindow(long from, long to)
 {
-    while (time(NULL) < deadline)
+    long jobs = 0, turnaround = 0;
+    for (long second = from; second < to && second < timelineSeconds; second++)
     {
-        // sleep for UNIT_TIME seconds
-        pthread_sleep(emergencyFrequency * UNIT_TIME);
+        jobs += atomic_load(&timelineJobs[second]);
+        turnaround += atomic_load(&timelineTurnaround[second]);
+    }
+    if (to <= from)
+    {
+        printf(" %8s %8s", "-", "-");
+    }
+    else
+    {
+        printf(" %8.3f %8.1f", (double)jobs / (to - from), jobs ? turnaround / 1000.0 / jobs : 0.0);
+    }
+}
 
-        // create 2 emergency landing jobs
-        for (int i = 0; i < 2; i++)
+// throughput and turnaround of the jobs completed during every outage that started, and in windows as long
+// before and after it, cut short by the start and the end of the run
+void PrintOutageReport()
+{
+    long last = shutdownMillis / 1000;
+    printf("Outages (jobs/s and mean turnaround s of the completed jobs)\n");
+    printf("%-4s %8s %8s %9s %17s %17s %17s\n", "Pad", "Start s", "End s", "Stranded", "before", "during", "after");
+    for (int k = 0; k < outageCount; k++)
+    {
+        Outage *outage = &outages[k];
+        if (outage->state == 0)
         {
-            Job j;
-            j.ID = rand() % 1000;
-            j.type = EMERGENCY_JOB;
-            j.duration = EMERGENCY_JOB_DURATION;
-            j.arrivalTime = time(NULL) - simulationStartTime;
-
-            pthread_mutex_lock(&emergencyQueueMutex);
-
-            Enqueue(emergencyQueue, j);
-
-            pthread_mutex_unlock(&emergencyQueueMutex);
+            continue;
         }
+        long start = outage->start / 1000;
+        long end = outage->state == 2 ? (outage->end + 999) / 1000 : last;
+        long stranded = outage->state == 2 ? outage->stranded : atomic_load(&outage->pad->stranded) - outage->stranded;
+        long length = end - start;
+        printf("%-4s %8.1f %8.1f %9ld", outage->pad->name, outage->start / 1000.0, outage->end / 1000.0, stranded);
+        PrintTimelineWindow(start - length > 0 ? start - length : 0, start);
+        PrintTimelineWindow(start, end);
+        PrintTimelineWindow(end, end + length < last ? end + length : last);
+        printf("\n");
     }
-
-    return NULL;
 }
 
-// the function that creates plane threads for emergency landing
-void *AssemblyJob(void *arg)
+// the capacity versus latency tradeoff of --autoscale: for every number of active pads the time spent at it,
+// and the jobs completed meanwhile with their throughput per pad and mean turnaround
+void PrintScaleReport()
 {
-    while (time(NULL) < deadline)
+    LockMutex(&scaleMutex);
+    scaleMillis[activePads] += shutdownMillis - scaleSince;
+    scaleSince = shutdownMillis;
+    UnlockMutex(&scaleMutex);
+
+    long total = 0;
+    double padMillis = 0;
+    for (int k = 0; k <= padCount; k++)
     {
-        // sleep for UNIT_TIME seconds
-        pthread_sleep(UNIT_TIME);
-
-        // create a landing job with probability p/2
-        if (rand() % 100 < (p / 2) * 100)
+        total += scaleMillis[k];
+        padMillis += (double)k * scaleMillis[k];
+    }
+    printf("Autoscaling (%d to %d pads, %ld ups, %ld downs, mean %.2f pads active)\n", scaleMin, scaleMax,
+           atomic_load(&scaleUps), atomic_load(&scaleDowns), total > 0 ? padMillis / total : 0.0);
+    printf("%-5s %8s %6s %8s %8s %10s %12s\n", "Pads", "Time s", "Share", "Jobs", "Jobs/s", "Jobs/pad-s", "Turnaround s");
+    for (int k = 1; k <= padCount; k++)
+    {
+        long jobs = atomic_load(&scaleJobs[k]);
+        if (scaleMillis[k] == 0 && jobs == 0)
         {
-            Job j;
-            j.ID = rand() % 1000;
-            j.type = ASSEMBLY_JOB;
-            j.duration = ASSEMBLY_JOB_DURATION;
-            j.arrivalTime = time(NULL) - simulationStartTime;
-
-            pthread_mutex_lock(&assemblyQueueMutex);
-
-            Enqueue(assemblyQueue, j);
-
-            pthread_mutex_unlock(&assemblyQueueMutex);
+            continue;
         }
+        double seconds = scaleMillis[k] / 1000.0;
+        printf("%-5d %8.1f %5.1f%% %8ld %8.3f %10.3f %12.2f\n", k, seconds, total > 0 ? 100.0 * scaleMillis[k] / total : 0.0,
+               jobs, seconds > 0 ? jobs / seconds : 0.0, seconds > 0 ? jobs / seconds / k : 0.0,
+               jobs > 0 ? atomic_load(&scaleTurnaround[k]) / 1000.0 / jobs : 0.0);
     }
+}
 
-    return NULL;
+// print one queue's line of the backlog report and add it to the totals
+static void PrintBacklogLine(const char *name, Queue *queue, int inFlight, long *totals)
+{
+    long oldest, ages = QueueAges(queue, shutdownMillis, &oldest);
+    int size = QueueSize(queue);
+    printf("%-22s %7d %9d %10.3f %10.3f %12.3f\n", name, size, inFlight, oldest / 1000.0, ages / 1000.0 / size, QueueDuration(queue) / 1000.0);
+    totals[0] += size;
+    totals[1] += inFlight;
+    totals[2] = oldest > totals[2] ? oldest : totals[2];
+    totals[3] += ages;
+    totals[4] += QueueDuration(queue);
 }
 
-// the function that controls the air traffic
-void *ControlTower(void *arg)
+// the jobs left when the simulation ended, they are neither logged nor in the turnaround numbers: per queue
+// their count, how many were being served, their oldest and mean age at the deadline and their queued
+// duration. Called after every thread is joined, the mailboxes are emptied into a queue to count them.
+void PrintBacklogReport()
 {
-    while (time(NULL) < deadline)
+    long totals[5] = {0}; // jobs, in flight, oldest, summed ages, duration
+    int header = FALSE;
+    if (drain)
     {
-        pthread_mutex_lock(&emergencyQueueMutex);
-
-        // if there is a emergency job, then add it to the padA emergency queue
-        if (emergencyQueue->size > 0)
-        {
-            pthread_mutex_lock(&padAEmergencyQueueMutex);
-
-            Enqueue(padAEmergencyQueue, Dequeue(emergencyQueue));
-
-            pthread_mutex_unlock(&padAEmergencyQueueMutex);
-        }
+        printf("Drained %ld jobs in %.3f s after the deadline\n", drainedJobs, drainMillis / 1000.0);
+    }
 
-        // if there is a emergency job, then add it to the padB emergency queue
-        if (emergencyQueue->size > 0)
+    for (int k = 0; k < allQueueCount + towerCount; k++)
+    {
+        Queue *queue = k < allQueueCount ? allQueues[k] : ConstructQueue(MAILBOX_CAPACITY);
+        char name[48];
+        int inFlight = 0;
+        if (k < allQueueCount)
         {
-            pthread_mutex_lock(&padBEmergencyQueueMutex);
-
-            Enqueue(padBEmergencyQueue, Dequeue(emergencyQueue));
-
-            pthread_mutex_unlock(&padBEmergencyQueueMutex);
+            snprintf(name, sizeof(name), "%s", allQueueNames[k]);
         }
-
-        pthread_mutex_unlock(&emergencyQueueMutex);
-
-        pthread_mutex_lock(&launchQueueMutex);
-        pthread_mutex_lock(&assemblyQueueMutex);
-
-        // if the launch and assembly queue has less than 3 jobs, then empty the landing queue
-        if (launchQueue->size < 3 && assemblyQueue->size < 3)
+        else
         {
-            pthread_mutex_unlock(&launchQueueMutex);
-            pthread_mutex_unlock(&assemblyQueueMutex);
-
-            pthread_mutex_lock(&landingQueueMutex);
-
-            // empty the landing queue
-            while (!isEmpty(landingQueue))
-            {
-                // lock padAQueue and padBQueue
-                pthread_mutex_lock(&padAQueueMutex);
-                pthread_mutex_lock(&padBQueueMutex);
-
-                if (padAQueue->duration <= padBQueue->duration)
-                {
-                    Enqueue(padAQueue, Dequeue(landingQueue));
-                }
-                else
-                {
-                    Enqueue(padBQueue, Dequeue(landingQueue));
-                }
-
-                pthread_mutex_unlock(&padAQueueMutex);
-                pthread_mutex_unlock(&padBQueueMutex);
-            }
-
-            pthread_mutex_unlock(&landingQueueMutex);
-
-            pthread_mutex_lock(&padAQueueMutex);
-            pthread_mutex_lock(&launchQueueMutex);
-
-            if (!isEmpty(launchQueue))
-            {
-                Enqueue(padAQueue, Dequeue(launchQueue));
-            }
-
-            pthread_mutex_unlock(&padAQueueMutex);
-            pthread_mutex_unlock(&launchQueueMutex);
-
-            pthread_mutex_lock(&padBQueueMutex);
-            pthread_mutex_lock(&assemblyQueueMutex);
-
-            if (!isEmpty(assemblyQueue))
+            // borrow the mailbox's jobs to measure them, they go back below for the checkpoint
+            Job j;
+            snprintf(name, sizeof(name), "%s mailbox", shards[k - allQueueCount].threadName);
+            while (MailboxPop(shards[k - allQueueCount].mailbox, &j))
             {
-                Enqueue(padBQueue, Dequeue(assemblyQueue));
+                Enqueue(queue, j);
             }
-
-            pthread_mutex_unlock(&padBQueueMutex);
-            pthread_mutex_unlock(&assemblyQueueMutex);
         }
-        else // Take one job from each queue
+        // the head of a pad queue is in flight while the pad serves it, the same for an emergency queue
+        for (int i = 0; i < padCount; i++)
         {
-            pthread_mutex_lock(&padAQueueMutex);
-            pthread_mutex_lock(&padBQueueMutex);
+            inFlight |= (queue == pads[i].queue && pads[i].segment == SEGMENT_JOB) ||
+                        (queue == pads[i].emergencyQueue && pads[i].segment == SEGMENT_EMERGENCY);
+        }
 
-            // if launchQueue is not empty, take the first job from launchQueue and put it in padAQueue
-            if (!isEmpty(launchQueue))
+        if (QueueSize(queue) > 0)
+        {
+            if (!header)
             {
-                Enqueue(padAQueue, Dequeue(launchQueue));
+                printf("Backlog at the end (ages at %.3f s)\n", shutdownMillis / 1000.0);
+                printf("%-22s %7s %9s %10s %10s %12s\n", "Queue", "Jobs", "In flight", "Oldest s", "Mean age s", "Duration s");
+                header = TRUE;
             }
-
-            pthread_mutex_unlock(&launchQueueMutex);
-
-            // if assemblyQueue is not empty, take the first job from assemblyQueue and put it in padBQueue
-            if (!isEmpty(assemblyQueue))
+            PrintBacklogLine(name, queue, inFlight, totals);
+        }
+        if (k >= allQueueCount)
+        {
+            while (!isEmpty(queue))
             {
-                Enqueue(padBQueue, Dequeue(assemblyQueue));
+                MailboxPush(shards[k - allQueueCount].mailbox, Dequeue(queue));
             }
+            DestructQueue(queue);
+        }
+    }
 
-            pthread_mutex_unlock(&assemblyQueueMutex);
+    if (header)
+    {
+        printf("%-22s %7ld %9ld %10.3f %10.3f %12.3f\n", "total", totals[0], totals[1], totals[2] / 1000.0, totals[3] / 1000.0 / totals[0],
+               totals[4] / 1000.0);
+    }
+}
 
-            // if landingQueue is not empty, take the first job from landingQueue and put it in shortest pad
-            pthread_mutex_lock(&landingQueueMutex);
-            if (!isEmpty(landingQueue))
+// how the load was spread over the towers and how many landings they handed to each other
+void PrintTowerReport()
+{
+    printf("Towers (migration margin %ld ms)\n", migrateMargin);
+    printf("%-14s %-16s %12s %12s %12s\n", "Tower", "Pads", "Jobs served", "Migrated out", "Migrated in");
+    for (int s = 0; s < towerCount; s++)
+    {
+        char names[17] = "";
+        long served = 0;
+        for (int i = 0; i < shards[s].padCount; i++)
+        {
+            if (strlen(names) + strlen(shards[s].pads[i]->name) + 1 < sizeof(names))
             {
-                if (padAQueue->duration <= padBQueue->duration)
-                {
-                    Enqueue(padAQueue, Dequeue(landingQueue));
-                }
-                else
-                {
-                    Enqueue(padBQueue, Dequeue(landingQueue));
-                }
+                strcat(names, i ? "," : "");
+                strcat(names, shards[s].pads[i]->name);
             }
-
-            pthread_mutex_unlock(&padAQueueMutex);
-            pthread_mutex_unlock(&padBQueueMutex);
-            pthread_mutex_unlock(&landingQueueMutex);
+            served += atomic_load(&shards[s].pads[i]->jobsServed);
         }
+        printf("%-14s %-16s %12ld %12ld %12ld\n", shards[s].threadName, names, served, atomic_load(&shards[s].migratedOut),
+               atomic_load(&shards[s].migratedIn));
     }
-
-    return NULL;
 }
 
-void *PadA(void *arg)
+// simulate with push dispatch and then with pull dispatch, each in a child process with the same arguments
+// and seed, and print their waits side by side. Returns TRUE in the children, which go on to simulate.
+int CompareDispatch()
 {
-    while (time(NULL) < deadline)
-    {
+    const char *modes[] = {"push", "pull"};
+    DispatchSummary summaries[2];
+    int ok[2] = {FALSE, FALSE};
 
-        // if there is a emergency job, then do it immediately
-        pthread_mutex_lock(&padAEmergencyQueueMutex);
-        if (padAEmergencyQueue->size > 0)
+    for (int mode = 0; mode < 2; mode++)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
         {
-
-            int sleepTime = padAEmergencyQueue->head->data.duration;
-
-            pthread_mutex_unlock(&padAEmergencyQueueMutex);
-
-            pthread_sleep(sleepTime);
-
-            pthread_mutex_lock(&padAEmergencyQueueMutex);
-            Job j = Dequeue(padAEmergencyQueue);
-            pthread_mutex_unlock(&padAEmergencyQueueMutex);
-
-            // Write the job to the log file
-            WriteLog(j, 'A');
-            continue;
+            perror("pipe");
+            return FALSE;
         }
-        pthread_mutex_unlock(&padAEmergencyQueueMutex);
+        printf("%s dispatch\n", modes[mode]);
+        fflush(stdout);
 
-        // if there is no job in the padA queue, then sleep
-        pthread_mutex_lock(&padAQueueMutex);
-        if (isEmpty(padAQueue))
+        pid_t child = fork();
+        if (child == 0)
         {
-            pthread_mutex_unlock(&padAQueueMutex);
-            // sleep for UNIT_TIME seconds
-            pthread_sleep(UNIT_TIME);
+            close(fds[0]);
+            pullDispatch = mode;
+            summaryFd = fds[1];
+            return TRUE;
         }
-        else // do the job
+        close(fds[1]);
+        ok[mode] = child > 0 && read(fds[0], &summaries[mode], sizeof(DispatchSummary)) == sizeof(DispatchSummary);
+        close(fds[0]);
+        if (child > 0)
         {
-            int sleepTime = padAQueue->head->data.duration;
-
-            pthread_mutex_unlock(&padAQueueMutex);
-
-            pthread_sleep(sleepTime); // Job is done
-
-            pthread_mutex_lock(&padAQueueMutex);
-            Job j = Dequeue(padAQueue);
-            pthread_mutex_unlock(&padAQueueMutex);
-
-            // Write the job to the log file
-            WriteLog(j, 'A');
+            waitpid(child, NULL, 0);
         }
     }
+    if (!ok[0] || !ok[1])
+    {
+        fprintf(stderr, "a dispatch run did not report\n");
+        return FALSE;
+    }
 
-    return NULL;
-}
-
-void *PadB(void *arg)
-{
-    while (time(NULL) < deadline)
+    printf("Push vs pull dispatch (%d s, seed %d)\n", simulationTime, seed);
+    printf("%-10s %10s %10s %14s %14s %14s %14s\n", "Type", "Push jobs", "Pull jobs", "Push wait ms", "Pull wait ms", "Push sojourn ms",
+           "Pull sojourn ms");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
     {
-        // if there is a emergency job, then do it immediately
-        pthread_mutex_lock(&padBEmergencyQueueMutex);
-        if (padBEmergencyQueue->size > 0)
+        printf("%-10s", GetTypeName(type));
+        for (int mode = 0; mode < 2; mode++)
         {
-            int sleepTime = padBEmergencyQueue->head->data.duration;
-
-            pthread_mutex_unlock(&padBEmergencyQueueMutex);
-
-            pthread_sleep(sleepTime);
-
-            pthread_mutex_lock(&padBEmergencyQueueMutex);
-            Job j = Dequeue(padBEmergencyQueue);
-            pthread_mutex_unlock(&padBEmergencyQueueMutex);
-
-            // Write the job to the log file
-            WriteLog(j, 'B');
-            continue;
+            printf(" %10ld", summaries[mode].completed[type]);
         }
-        pthread_mutex_unlock(&padBEmergencyQueueMutex);
-
-        // if there is no job in the padB queue, then sleep
-        pthread_mutex_lock(&padBQueueMutex);
-        if (isEmpty(padBQueue))
+        for (int mode = 0; mode < 2; mode++)
         {
-            pthread_mutex_unlock(&padBQueueMutex);
-            // sleep for UNIT_TIME seconds
-            pthread_sleep(UNIT_TIME);
+            long completed = summaries[mode].completed[type];
+            printf(" %14.0f", completed ? (double)summaries[mode].waitMillis[type] / completed : 0.0);
         }
-        else // do the job
+        for (int mode = 0; mode < 2; mode++)
         {
-            int sleepTime = padBQueue->head->data.duration;
-
-            pthread_mutex_unlock(&padBQueueMutex);
-
-            pthread_sleep(sleepTime); // Job is done
-
-            pthread_mutex_lock(&padBQueueMutex);
-            Job j = Dequeue(padBQueue);
-            pthread_mutex_unlock(&padBQueueMutex);
-
-            // Write the job to the log file
-            WriteLog(j, 'B');
+            long completed = summaries[mode].completed[type];
+            printf(" %15.0f", completed ? (double)summaries[mode].sojournMillis[type] / completed : 0.0);
         }
+        printf("\n");
     }
-    return NULL;
+    for (int mode = 0; mode < 2; mode++)
+    {
+        printf("%s turnaround p50 %ld p90 %ld p99 %ld s\n", modes[mode], summaries[mode].turnaround[0], summaries[mode].turnaround[1],
+               summaries[mode].turnaround[2]);
+    }
+    return FALSE;
 }
 
-// Write the job to the log file
-void *WriteLog(Job j, char pad)
+// the queueing model of the pads, classes are indexed by type. Emergencies preempt everything and the
+// control tower hands out landings before launch and assembly jobs, which share the lowest priority.
+// Which pads can serve which types is not modelled.
+void BuildQueueModel(QueueClass *classes)
 {
-    // Create log string
-    time_t end_time = time(NULL) - simulationStartTime;
-    char log[100];
-    sprintf(log, "%-5d %5c %11d %13ld %11ld %10c\n", j.ID, GetType(j.type), j.arrivalTime, end_time, end_time - j.arrivalTime, pad);
-
-    // open the log file and write the log string
-    pthread_mutex_lock(&logFileMutex);
-    FILE *fp = fopen("log.txt", "a");
-    fprintf(fp, "%s", log);
-    fclose(fp);
-    pthread_mutex_unlock(&logFileMutex);
-
-    return NULL;
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        JobType *jobType = &jobTypes[type];
+        QueueClass *c = &classes[type];
+        double arrivals = jobType->arrival.kind == DIST_NONE ? jobType->percent / 100 / (jobType->period * UNIT_TIME)
+                                                             : 1 / DistributionMean(&jobType->arrival);
+        c->rate = arrivals * jobType->producers * jobType->batch;
+        c->meanService = DistributionMean(&jobType->service);
+        c->scv = DistributionScv(&jobType->service);
+        c->level = type == EMERGENCY_JOB ? 0 : type == LANDING_JOB ? 1 : 2;
+        c->preemptive = type == EMERGENCY_JOB;
+    }
+    EstimatePriorityQueue(&classes[LANDING_JOB], JOB_TYPE_END - LANDING_JOB, padCount);
 }
 
-// Write the current status of the queues to the console periodically
-void *PrintCurrentQueues(void *arg)
+void PrintEstimate(QueueClass *classes)
 {
-    while (time(NULL) < deadline)
+    printf("Estimate (M/G/%d with priorities: emergency, landing, launch and assembly)\n", padCount);
+    printf("%-10s %12s %12s %12s %16s %16s\n", "Type", "Arrivals/s", "Throughput/s", "Utilization", "Mean wait us", "Mean sojourn us");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
     {
-        // sleep for 1 second
-        pthread_sleep(1);
-
-        int current_time = time(NULL) - simulationStartTime;
-        if (n <= current_time)
-        {
-            // print the landing queue
-            pthread_mutex_lock(&landingQueueMutex);
-            printf("At %d sec landing: ", current_time);
-            PrintQueue(landingQueue);
-            pthread_mutex_unlock(&landingQueueMutex);
-
-            // print the launch queue
-            pthread_mutex_lock(&launchQueueMutex);
-            printf("At %d sec launch: ", current_time);
-            PrintQueue(launchQueue);
-            pthread_mutex_unlock(&launchQueueMutex);
-
-            // print the assembly queue
-            pthread_mutex_lock(&assemblyQueueMutex);
-            printf("At %d sec assembly: ", current_time);
-            PrintQueue(assemblyQueue);
-            pthread_mutex_unlock(&assemblyQueueMutex);
-
-            // print the padA queue
-            pthread_mutex_lock(&padAQueueMutex);
-            printf("At %d sec padA: ", current_time);
-            PrintQueue(padAQueue);
-            pthread_mutex_unlock(&padAQueueMutex);
-
-            // print the padB queue
-            pthread_mutex_lock(&padBQueueMutex);
-            printf("At %d sec padB: ", current_time);
-            PrintQueue(padBQueue);
-            pthread_mutex_unlock(&padBQueueMutex);
-
-            // print the padA emergency queue
-            pthread_mutex_lock(&padAEmergencyQueueMutex);
-            printf("At %d sec padA emergency: ", current_time);
-            PrintQueue(padAEmergencyQueue);
-            pthread_mutex_unlock(&padAEmergencyQueueMutex);
-
-            // print the padB emergency queue
-            pthread_mutex_lock(&padBEmergencyQueueMutex);
-            printf("At %d sec padB emergency: ", current_time);
-            PrintQueue(padBEmergencyQueue);
-            pthread_mutex_unlock(&padBEmergencyQueueMutex);
+        QueueClass *c = &classes[type];
+        printf("%-10s %12.4f %12.4f %11.1f%% %16.0f %16.0f\n", GetTypeName(type), c->rate, c->throughput, 100 * c->utilization,
+               c->wait * 1e6, c->sojourn * 1e6);
+    }
+}
 
-            printf("\n");
-        }
+static void PrintError(double simulated, double estimated)
+{
+    if (simulated > 0 && isfinite(estimated))
+    {
+        printf(" %7.1f%%", 100 * (estimated - simulated) / simulated);
+    }
+    else
+    {
+        printf(" %8s", "-");
     }
+}
 
-    return NULL;
+// compare the estimate with what the simulation measured, errors are relative to the simulation
+void PrintEstimateCheck(QueueClass *classes)
+{
+    printf("Simulated %d s vs estimate\n", simulationTime);
+    printf("%-10s %12s %12s %8s %14s %14s %8s\n", "Type", "Sim jobs/s", "Est jobs/s", "Error", "Sim wait us", "Est wait us", "Error");
+    for (int type = LANDING_JOB; type < JOB_TYPE_END; type++)
+    {
+        QueueClass *c = &classes[type];
+        long completed = atomic_load(&completedJobs[type]);
+        double throughput = (double)completed / simulationTime;
+        double wait = completed ? atomic_load(&waitMillis[type]) * 1000.0 / completed : 0;
+
+        printf("%-10s %12.4f %12.4f", GetTypeName(type), throughput, c->throughput);
+        PrintError(throughput, c->throughput);
+        printf(" %14.0f %14.0f", wait, c->wait * 1e6);
+        PrintError(wait, c->wait * 1e6);
+        printf("\n");
+    }
 }
 
 void PrintQueue(Queue *q)
@@ -633,26 +3822,210 @@ void PrintQueue(Queue *q)
         NODE *curr = q->head;
         while (curr != NULL)
         {
-            printf("%d ", curr->data.ID);
+            printf("%" PRIu64 " ", curr->data.ID);
             curr = curr->prev;
         }
         printf("\n");
     }
 }
 
-char GetType(int type)
+// a unique job ID, see jobThreadTag
+uint64_t NextJobID()
 {
-    switch (type)
+    if (jobThreadTag == 0)
     {
-    case LANDING_JOB:
-        return 'L';
-    case LAUNCH_JOB:
-        return 'D';
-    case ASSEMBLY_JOB:
-        return 'A';
-    case EMERGENCY_JOB:
-        return 'E';
-    default:
-        return 'U'; // For unknown type
+        jobThreadTag = atomic_fetch_add(&nextThreadTag, 1) + 1;
+    }
+    return (jobThreadTag << 48) | ++jobSequence;
+}
+
+// write the state of a finished simulation: its clock, the job ID tags, the pad and producer counts,
+// the producers' random states and every queue. Jobs the pads were serving are at the head of their
+// queues, with the part served so far, so a restored pad resumes them.
+int WriteCheckpoint(const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        return FALSE;
+    }
+
+    // account the served part of the in-flight jobs
+    for (int i = 0; i < padCount; i++)
+    {
+        Pad *pad = &pads[i];
+        long elapsed = shutdownMillis - pad->segmentStart;
+        if (elapsed > pad->segmentLength)
+        {
+            elapsed = pad->segmentLength;
+        }
+        if (pad->segment == SEGMENT_JOB && !isEmpty(pad->queue))
+        {
+            pad->queue->head->data.served += elapsed;
+        }
+        else if (pad->segment == SEGMENT_EMERGENCY && !isEmpty(pad->emergencyQueue))
+        {
+            pad->emergencyQueue->head->data.served += elapsed;
+        }
+        pad->segment = SEGMENT_NONE;
+    }
+
+    uint32_t header[2] = {CHECKPOINT_MAGIC, CHECKPOINT_VERSION};
+    int64_t elapsed = shutdownMillis;
+    uint64_t tag = atomic_load(&nextThreadTag);
+    int32_t counts[2] = {padCount, producerCount};
+
+    int ok = fwrite(header, sizeof(header), 1, fp) == 1 && fwrite(&elapsed, sizeof(elapsed), 1, fp) == 1 &&
+             fwrite(&tag, sizeof(tag), 1, fp) == 1 && fwrite(counts, sizeof(counts), 1, fp) == 1;
+    for (int i = 0; ok && i < allProducerCount; i++)
+    {
+        // the samples a producer drew ahead, and the jobs of an arrival the intake queue had no room for yet
+        Producer *producer = &producers[i];
+        int32_t blocked = producer->blocked;
+        ok = fwrite(&producer->rng, sizeof(uint64_t), 1, fp) == 1 && SaveSampler(&producer->arrivals, fp) &&
+             SaveSampler(&producer->services, fp) && fwrite(&producer->blockedJob, sizeof(Job), 1, fp) == 1 &&
+             fwrite(&blocked, sizeof(blocked), 1, fp) == 1;
+    }
+    for (int type = LANDING_JOB; ok && type < JOB_TYPE_END; type++)
+    {
+        ok = SaveQueue(*jobTypes[type].queue, fp);
+    }
+    for (int i = 0; ok && i < padCount; i++)
+    {
+        ok = SaveQueue(pads[i].queue, fp) && SaveQueue(pads[i].emergencyQueue, fp);
+    }
+    for (int s = 0; ok && s < towerCount; s++)
+    {
+        // the jobs handed back by pads that went down and not redispatched yet, the towers have stopped
+        Queue *mail = ConstructQueue(0);
+        Job j;
+        while (MailboxPop(shards[s].mailbox, &j))
+        {
+            Enqueue(mail, j);
+        }
+        ok = SaveQueue(mail, fp);
+        DestructQueue(mail);
+    }
+
+    return fclose(fp) == 0 && ok;
+}
+
+// read a checkpoint's header and take its pad and producer counts, the rest is read by LoadCheckpoint
+FILE *OpenCheckpoint(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        return NULL;
+    }
+
+    uint32_t header[2];
+    int32_t counts[2];
+    if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != CHECKPOINT_MAGIC || header[1] != CHECKPOINT_VERSION ||
+        fseek(fp, sizeof(int64_t) + sizeof(uint64_t), SEEK_CUR) != 0 || fread(counts, sizeof(counts), 1, fp) != 1 ||
+        counts[0] < 1 || counts[1] < 1)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    padCount = counts[0];
+    producerCount = counts[1];
+    return fp;
+}
+
+// restore the clock, ID tags, random states and queues, once the queues and producers are constructed
+int LoadCheckpoint(FILE *fp)
+{
+    int64_t elapsed;
+    uint64_t tag;
+    fseek(fp, 2 * sizeof(uint32_t), SEEK_SET);
+    int ok = fread(&elapsed, sizeof(elapsed), 1, fp) == 1 && fread(&tag, sizeof(tag), 1, fp) == 1 &&
+             fseek(fp, 2 * sizeof(int32_t), SEEK_CUR) == 0;
+    for (int i = 0; ok && i < allProducerCount; i++)
+    {
+        Producer *producer = &producers[i];
+        int32_t blocked;
+        ok = fread(&producer->rng, sizeof(uint64_t), 1, fp) == 1 && LoadSampler(&producer->arrivals, fp) &&
+             LoadSampler(&producer->services, fp) && fread(&producer->blockedJob, sizeof(Job), 1, fp) == 1 &&
+             fread(&blocked, sizeof(blocked), 1, fp) == 1 && blocked >= 0;
+        producer->blocked = blocked;
+        producer->blockedSince = elapsed; // the checkpointed run accounted its blocked time up to its end
+    }
+    int dropped = 0;
+    for (int type = LANDING_JOB; ok && type < JOB_TYPE_END; type++)
+    {
+        ok = LoadQueue(*jobTypes[type].queue, fp, &dropped);
+    }
+    for (int i = 0; ok && i < padCount; i++)
+    {
+        ok = LoadQueue(pads[i].queue, fp, &dropped) && LoadQueue(pads[i].emergencyQueue, fp, &dropped);
+    }
+    for (int s = 0; ok && s < towerCount; s++)
+    {
+        Queue *mail = ConstructQueue(0);
+        ok = LoadQueue(mail, fp, &dropped);
+        while (!isEmpty(mail))
+        {
+            if (MailboxPush(shards[s].mailbox, Dequeue(mail)))
+            {
+                atomic_fetch_add(&jobsInSystem, 1);
+            }
+            else
+            {
+                dropped++;
+            }
+        }
+        DestructQueue(mail);
+    }
+    fclose(fp);
+
+    // a smaller --queue-limit than the checkpointed run's has no room for all of its jobs
+    if (dropped > 0)
+    {
+        fprintf(stderr, "%d jobs of the checkpoint did not fit the queues and were dropped\n", dropped);
+    }
+
+    // the simulated clock continues where the checkpoint stopped, new IDs never reuse its tags
+    startMillis = EpochMillis() - elapsed;
+    simulationStartTime = startMillis / 1000;
+    atomic_store(&nextThreadTag, tag);
+    return ok;
+}
+
+// a new job that arrives now and takes duration milliseconds to serve
+Job CreateJob(int type, int duration)
+{
+    Job j;
+    j.ID = NextJobID();
+    j.type = type;
+    j.duration = duration;
+    j.arrivalTime = time(NULL) - simulationStartTime;
+    j.served = 0;
+    j.createdAt = CurrentMillis();
+    j.dispatchedAt = -1;
+    j.startedAt = -1;
+    j.completedAt = -1;
+    return j;
+}
+
+// stamp a job the control tower hands to a pad
+Job Dispatched(Job j)
+{
+    j.dispatchedAt = CurrentMillis();
+    if (stress)
+    {
+        HistogramAdd(&stressLatency[atomic_load(&stressStep)], j.dispatchedAt - j.createdAt);
     }
-}
\ No newline at end of file
+    return j;
+}
+
+// the job type as a static string
+const char *GetTypeName(int type)
+{
+    return jobTypes[type > NO_JOB && type < JOB_TYPE_END ? type : NO_JOB].name;
+}
+
+char GetType(int type)
+{
+    return jobTypes[type > NO_JOB && type < JOB_TYPE_END ? type : NO_JOB].letter; // 'U' for unknown type
+}
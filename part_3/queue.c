@@ -1,15 +1,24 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <inttypes.h>
 
 #define TRUE  1
 #define FALSE 0
 
 typedef struct {
-    int ID;
+    uint64_t ID;
     int type;
     // you might want to add variables here!
-    int duration;
+    int duration; // milliseconds
     int arrivalTime;
+    int served; // milliseconds of service already done before a preemption
+    /* lifecycle in milliseconds since the start of the simulation, -1 until it happens */
+    long createdAt;
+    long dispatchedAt; // handed to a pad by the control tower
+    long startedAt;    // first moment a pad served it
+    long completedAt;
 } Job;
 
 /* a link in the queue, holds the data and point to the next Node */
@@ -18,13 +27,30 @@ typedef struct Node_t {
     struct Node_t *prev;
 } NODE;
 
+/* a change of a queue, for displays that print what changed instead of the whole queue */
+typedef struct {
+    uint64_t ID;
+    char change; /* '+' enqueued, '-' dequeued */
+} QueueChange;
+
+/* the changes of a queue since it was last taken, the first capacity of them with their IDs */
+typedef struct {
+    QueueChange *changes;
+    int count;
+    int capacity;
+    long enqueued;
+    long dequeued;
+} QueueJournal;
+
 /* the HEAD of the Queue, hold the amount of node's that are in the queue */
+/* size and duration are atomic so they can be read without holding the queue's mutex */
 typedef struct Queue {
     NODE *head;
     NODE *tail;
-    int size;
-    int duration;
+    atomic_int size;
+    atomic_int duration;
     int limit;
+    QueueJournal *journal; /* NULL unless the queue's changes are recorded */
 } Queue;
 
 Queue *ConstructQueue(int limit);
@@ -32,6 +58,15 @@ void DestructQueue(Queue *queue);
 int Enqueue(Queue *pQueue, Job j);
 Job Dequeue(Queue *pQueue);
 int isEmpty(Queue* pQueue);
+int isFull(Queue *pQueue);
+int QueueSize(Queue *pQueue);
+int QueueDuration(Queue *pQueue);
+long QueueAges(Queue *pQueue, long now, long *oldest);
+QueueJournal *CreateJournal(int capacity);
+void DestroyJournal(QueueJournal *journal);
+QueueJournal *SwapJournal(Queue *pQueue, QueueJournal *empty);
+int SaveQueue(Queue *pQueue, FILE *fp);
+int LoadQueue(Queue *pQueue, FILE *fp, int *dropped);
 
 Queue *ConstructQueue(int limit) {
     Queue *queue = (Queue*) malloc(sizeof (Queue));
@@ -42,10 +77,11 @@ Queue *ConstructQueue(int limit) {
         limit = 65535;
     }
     queue->limit = limit;
-    queue->size = 0;
-    queue->duration = 0;
+    atomic_init(&queue->size, 0);
+    atomic_init(&queue->duration, 0);
     queue->head = NULL;
     queue->tail = NULL;
+    queue->journal = NULL;
 
     return queue;
 }
@@ -55,21 +91,43 @@ void DestructQueue(Queue *queue) {
     while (!isEmpty(queue)) {
         Dequeue(queue);
     }
+    DestroyJournal(queue->journal);
     free(queue);
 }
 
+/* record a change in the queue's journal, if it has one */
+static void JournalChange(Queue *pQueue, uint64_t ID, char change) {
+    QueueJournal *journal = pQueue->journal;
+    if (journal == NULL) {
+        return;
+    }
+    if (journal->count < journal->capacity) {
+        journal->changes[journal->count].ID = ID;
+        journal->changes[journal->count].change = change;
+        journal->count++;
+    }
+    if (change == '+') {
+        journal->enqueued++;
+    } else {
+        journal->dequeued++;
+    }
+}
+
+/* returns FALSE, without taking the job, if the queue is full */
 int Enqueue(Queue *pQueue, Job j) {
     /* Bad parameter */
-    NODE* item = (NODE*) malloc(sizeof (NODE));
-    item->data = j;
-
-    if ((pQueue == NULL) || (item == NULL)) {
+    if (pQueue == NULL) {
         return FALSE;
     }
     // if(pQueue->limit != 0)
     if (pQueue->size >= pQueue->limit) {
         return FALSE;
     }
+    NODE* item = (NODE*) malloc(sizeof (NODE));
+    if (item == NULL) {
+        return FALSE;
+    }
+    item->data = j;
     /*the queue is empty*/
     item->prev = NULL;
     if (pQueue->size == 0) {
@@ -81,8 +139,9 @@ int Enqueue(Queue *pQueue, Job j) {
         pQueue->tail->prev = item;
         pQueue->tail = item;
     }
-    pQueue->size++;
-    pQueue->duration += j.duration;
+    atomic_fetch_add_explicit(&pQueue->size, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pQueue->duration, j.duration, memory_order_relaxed);
+    JournalChange(pQueue, j.ID, '+');
     return TRUE;
 }
 
@@ -94,8 +153,9 @@ Job Dequeue(Queue *pQueue) {
         return ret;
     item = pQueue->head;
     pQueue->head = (pQueue->head)->prev;
-    pQueue->size--;
-    pQueue->duration -= item->data.duration;
+    atomic_fetch_sub_explicit(&pQueue->size, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&pQueue->duration, item->data.duration, memory_order_relaxed);
+    JournalChange(pQueue, item->data.ID, '-');
     ret = item->data;
     free(item);
     return ret;
@@ -110,4 +170,88 @@ int isEmpty(Queue* pQueue) {
     } else {
         return FALSE;
     }
-}
\ No newline at end of file
+}
+
+int isFull(Queue *pQueue) {
+    return pQueue->size >= pQueue->limit;
+}
+
+/* lock free reads, the value may be stale by the time the caller uses it */
+int QueueSize(Queue *pQueue) {
+    return atomic_load_explicit(&pQueue->size, memory_order_relaxed);
+}
+
+int QueueDuration(Queue *pQueue) {
+    return atomic_load_explicit(&pQueue->duration, memory_order_relaxed);
+}
+
+/* summed age at now of the queue's jobs by their createdAt, the largest in *oldest; the caller holds the queue's lock */
+long QueueAges(Queue *pQueue, long now, long *oldest) {
+    long sum = 0;
+    *oldest = 0;
+    for (NODE *item = pQueue->head; item != NULL; item = item->prev) {
+        long age = now - item->data.createdAt;
+        sum += age;
+        if (age > *oldest) {
+            *oldest = age;
+        }
+    }
+    return sum;
+}
+
+/* a journal that keeps the IDs of up to capacity changes, more are only counted */
+QueueJournal *CreateJournal(int capacity) {
+    QueueJournal *journal = (QueueJournal *) calloc(1, sizeof (QueueJournal));
+    journal->changes = (QueueChange *) malloc(capacity * sizeof (QueueChange));
+    journal->capacity = capacity;
+    return journal;
+}
+
+void DestroyJournal(QueueJournal *journal) {
+    if (journal != NULL) {
+        free(journal->changes);
+        free(journal);
+    }
+}
+
+/* start recording into the empty journal and return the one recorded so far, the caller holds the queue's lock */
+QueueJournal *SwapJournal(Queue *pQueue, QueueJournal *empty) {
+    QueueJournal *full = pQueue->journal;
+    empty->count = 0;
+    empty->enqueued = 0;
+    empty->dequeued = 0;
+    pQueue->journal = empty;
+    return full;
+}
+
+/* write the queue's jobs to fp, head first */
+int SaveQueue(Queue *pQueue, FILE *fp) {
+    int32_t count = pQueue->size;
+    if (fwrite(&count, sizeof (count), 1, fp) != 1) {
+        return FALSE;
+    }
+    for (NODE *item = pQueue->head; item != NULL; item = item->prev) {
+        if (fwrite(&item->data, sizeof (Job), 1, fp) != 1) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* append the jobs written by SaveQueue to the queue, counting those its limit has no room for in dropped */
+int LoadQueue(Queue *pQueue, FILE *fp, int *dropped) {
+    int32_t count;
+    if (fread(&count, sizeof (count), 1, fp) != 1) {
+        return FALSE;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        Job j;
+        if (fread(&j, sizeof (Job), 1, fp) != 1) {
+            return FALSE;
+        }
+        if (!Enqueue(pQueue, j)) {
+            (*dropped)++;
+        }
+    }
+    return TRUE;
+}
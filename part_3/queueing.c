@@ -0,0 +1,98 @@
+#include <math.h>
+
+/*
+ * Approximate M/G/c queue with priority classes, for answering what-if questions without running
+ * a simulation. Waits use the Erlang C probability of waiting, scaled by (1 + SCV of service) / 2
+ * (Allen-Cunneen), and split between the priority levels with Cobham's formula. Classes of a
+ * preemptive level interrupt every lower level, their service inflates the lower levels' sojourn.
+ * All times are in seconds.
+ */
+
+typedef struct {
+    /* inputs */
+    double rate;        /* arrivals per second */
+    double meanService; /* seconds */
+    double scv;         /* squared coefficient of variation of the service time */
+    int level;          /* priority level, 0 is served first */
+    int preemptive;     /* interrupts the service of lower levels */
+    /* outputs */
+    double utilization; /* share of the servers' capacity spent on the class */
+    double throughput;  /* completions per second, less than rate if the class is overloaded */
+    double wait;        /* mean time until service starts, INFINITY if overloaded */
+    double sojourn;     /* mean time until service ends */
+} QueueClass;
+
+double ErlangC(int servers, double load);
+void EstimatePriorityQueue(QueueClass *classes, int count, int servers);
+
+/* probability that an arrival has to wait in an M/M/c queue with the offered load in servers */
+double ErlangC(int servers, double load) {
+    if (load >= servers) {
+        return 1;
+    }
+    double b = 1; /* Erlang B by the stable recursion */
+    for (int k = 1; k <= servers; k++) {
+        b = load * b / (k + load * b);
+    }
+    double rho = load / servers;
+    return b / (1 - rho * (1 - b));
+}
+
+/*
+ * Mean time until some server frees up for class i, over the classes that can hold the servers it
+ * waits for: all of them, unless class i is preemptive and only waits for its own and higher levels.
+ */
+static double BaseWait(QueueClass *classes, int count, int servers, int i) {
+    double rate = 0, load = 0, second = 0;
+    for (int k = 0; k < count; k++) {
+        if (classes[i].preemptive && classes[k].level > classes[i].level) {
+            continue;
+        }
+        rate += classes[k].rate;
+        load += classes[k].rate * classes[k].meanService;
+        second += classes[k].rate * (1 + classes[k].scv) * classes[k].meanService * classes[k].meanService;
+    }
+    if (load <= 0) {
+        return 0;
+    }
+    double meanService = load / rate;
+    double scv = second / rate / (meanService * meanService) - 1;
+    return ErlangC(servers, load) * meanService / servers * (1 + scv) / 2;
+}
+
+void EstimatePriorityQueue(QueueClass *classes, int count, int servers) {
+    for (int i = 0; i < count; i++) {
+        QueueClass *c = &classes[i];
+        double higher = 0, preempting = 0, own = 0;
+        for (int k = 0; k < count; k++) {
+            double rho = classes[k].rate * classes[k].meanService / servers;
+            if (classes[k].level < c->level) {
+                higher += rho;
+                if (classes[k].preemptive) {
+                    preempting += rho;
+                }
+            } else if (classes[k].level == c->level) {
+                own += rho;
+            }
+        }
+
+        // the capacity left by the higher levels is shared by this level in proportion to its load
+        double left = 1 - higher;
+        if (left <= 0) {
+            c->throughput = 0;
+        } else if (own <= left) {
+            c->throughput = c->rate;
+        } else {
+            c->throughput = c->rate * left / own;
+        }
+        c->utilization = c->throughput * c->meanService / servers;
+
+        if (higher + own >= 1) {
+            c->wait = INFINITY;
+            c->sojourn = INFINITY;
+        } else {
+            c->wait = BaseWait(classes, count, servers, i) / ((1 - higher) * (1 - higher - own));
+            c->sojourn = c->wait + c->meanService / (1 - preempting);
+        }
+    }
+}
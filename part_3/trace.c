@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * Chrome trace-event recorder. Every thread appends to its own buffer without locking,
+ * the buffers are only merged into a JSON file by TraceWrite() after the threads are joined.
+ * Open the file in chrome://tracing or ui.perfetto.dev.
+ */
+
+/*
+ * trace processes, thread activity, pad activity and lock holds are shown as separate groups of tracks.
+ * Locks get a track each: a thread may release its locks in any order, so its holds overlap without
+ * nesting, but the holds of one lock never overlap.
+ */
+#define TRACE_THREADS 1
+#define TRACE_PADS 2
+#define TRACE_LOCKS 3
+
+#define TRACE_MAX_HELD_LOCKS 8
+#define TRACE_MAX_OBJECTS 256
+
+typedef struct {
+    char phase;         /* 'X' span, 'i' instant */
+    int pid;
+    int tid;
+    const char *name;   /* static string */
+    const void *object; /* lock or other named object the event is about, NULL if none */
+    uint64_t id;        /* job ID, 0 if none */
+    long ts;            /* microseconds since TraceStart */
+    long dur;
+} TraceEvent;
+
+typedef struct TraceBuffer_t {
+    const char *threadName;
+    int tid;
+    TraceEvent *events;
+    int count;
+    int capacity;
+    const void *heldLocks[TRACE_MAX_HELD_LOCKS];
+    long heldSince[TRACE_MAX_HELD_LOCKS];
+    int held;
+    struct TraceBuffer_t *next;
+} TraceBuffer;
+
+atomic_int tracing;
+struct timespec traceStart;
+__thread TraceBuffer *traceBuffer;
+
+/* every registered buffer, the list is only changed when a thread registers itself */
+pthread_mutex_t traceBuffersMutex = PTHREAD_MUTEX_INITIALIZER;
+TraceBuffer *traceBuffers;
+int traceThreadCount;
+
+/* names of locks and pad tracks, set up before the threads start */
+const void *traceObjects[TRACE_MAX_OBJECTS];
+const char *traceObjectNames[TRACE_MAX_OBJECTS];
+int traceObjectCount;
+const char *tracePadNames[TRACE_MAX_OBJECTS];
+int tracePadCount;
+
+void TraceStart();
+void TraceThread(const char *name);
+void TraceNameObject(const void *object, const char *name);
+void TraceNamePad(int pad, const char *name);
+long TraceNow();
+void TraceLockAcquired(const void *lock);
+void TraceLockReleased(const void *lock);
+void TraceSpan(int pid, int tid, const char *name, uint64_t id, long start);
+void TraceInstant(const char *name, uint64_t id);
+int TraceWrite(const char *path);
+
+void TraceStart() {
+    clock_gettime(CLOCK_MONOTONIC, &traceStart);
+    atomic_store(&tracing, 1);
+}
+
+long TraceNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - traceStart.tv_sec) * 1000000L + (now.tv_nsec - traceStart.tv_nsec) / 1000;
+}
+
+/* give the calling thread a named track, threads that never call this are not traced */
+void TraceThread(const char *name) {
+    if (!atomic_load_explicit(&tracing, memory_order_relaxed)) {
+        return;
+    }
+    TraceBuffer *buffer = (TraceBuffer *) calloc(1, sizeof (TraceBuffer));
+    buffer->threadName = name;
+
+    pthread_mutex_lock(&traceBuffersMutex);
+    buffer->tid = ++traceThreadCount;
+    buffer->next = traceBuffers;
+    traceBuffers = buffer;
+    pthread_mutex_unlock(&traceBuffersMutex);
+
+    traceBuffer = buffer;
+}
+
+void TraceNameObject(const void *object, const char *name) {
+    if (traceObjectCount < TRACE_MAX_OBJECTS) {
+        traceObjects[traceObjectCount] = object;
+        traceObjectNames[traceObjectCount] = name;
+        traceObjectCount++;
+    }
+}
+
+void TraceNamePad(int pad, const char *name) {
+    if (pad < TRACE_MAX_OBJECTS) {
+        tracePadNames[pad] = name;
+        if (pad >= tracePadCount) {
+            tracePadCount = pad + 1;
+        }
+    }
+}
+
+static TraceEvent *TraceAppend() {
+    TraceBuffer *buffer = traceBuffer;
+    if (buffer->count == buffer->capacity) {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        buffer->events = (TraceEvent *) realloc(buffer->events, buffer->capacity * sizeof (TraceEvent));
+    }
+    return &buffer->events[buffer->count++];
+}
+
+void TraceLockAcquired(const void *lock) {
+    if (traceBuffer == NULL || traceBuffer->held == TRACE_MAX_HELD_LOCKS) {
+        return;
+    }
+    traceBuffer->heldLocks[traceBuffer->held] = lock;
+    traceBuffer->heldSince[traceBuffer->held] = TraceNow();
+    traceBuffer->held++;
+}
+
+/* locks are not always released in the reverse order they are taken, so search the held ones */
+void TraceLockReleased(const void *lock) {
+    if (traceBuffer == NULL) {
+        return;
+    }
+    for (int i = traceBuffer->held - 1; i >= 0; i--) {
+        if (traceBuffer->heldLocks[i] == lock) {
+            long since = traceBuffer->heldSince[i];
+            for (int k = i; k < traceBuffer->held - 1; k++) {
+                traceBuffer->heldLocks[k] = traceBuffer->heldLocks[k + 1];
+                traceBuffer->heldSince[k] = traceBuffer->heldSince[k + 1];
+            }
+            traceBuffer->held--;
+
+            TraceEvent *e = TraceAppend();
+            e->phase = 'X';
+            e->pid = TRACE_LOCKS;
+            e->tid = 0; /* the lock's track, numbered by TraceWrite */
+            e->name = traceBuffer->threadName;
+            e->object = lock;
+            e->id = 0;
+            e->ts = since;
+            e->dur = TraceNow() - since;
+            return;
+        }
+    }
+}
+
+/* a span from start until now, on the calling thread's track or on a pad track */
+void TraceSpan(int pid, int tid, const char *name, uint64_t id, long start) {
+    if (traceBuffer == NULL) {
+        return;
+    }
+    TraceEvent *e = TraceAppend();
+    e->phase = 'X';
+    e->pid = pid;
+    e->tid = pid == TRACE_THREADS ? traceBuffer->tid : tid;
+    e->name = name;
+    e->object = NULL;
+    e->id = id;
+    e->ts = start;
+    e->dur = TraceNow() - start;
+}
+
+void TraceInstant(const char *name, uint64_t id) {
+    if (traceBuffer == NULL) {
+        return;
+    }
+    TraceEvent *e = TraceAppend();
+    e->phase = 'i';
+    e->pid = TRACE_THREADS;
+    e->tid = traceBuffer->tid;
+    e->name = name;
+    e->object = NULL;
+    e->id = id;
+    e->ts = TraceNow();
+    e->dur = 0;
+}
+
+/* the track of a lock, a lock nobody named gets one called "lock" while there is room for its name */
+static int TraceObjectTrack(const void *object) {
+    for (int i = 0; i < traceObjectCount; i++) {
+        if (traceObjects[i] == object) {
+            return i;
+        }
+    }
+    if (traceObjectCount == TRACE_MAX_OBJECTS) {
+        return TRACE_MAX_OBJECTS;
+    }
+    TraceNameObject(object, "lock");
+    return traceObjectCount - 1;
+}
+
+/* merge every buffer into a trace-event JSON file and free them, returns FALSE on failure */
+int TraceWrite(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        return FALSE;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"threads\"}},\n", TRACE_THREADS);
+    fprintf(fp, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"pads\"}},\n", TRACE_PADS);
+    fprintf(fp, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"locks\"}}", TRACE_LOCKS);
+    for (int i = 0; i < tracePadCount; i++) {
+        fprintf(fp, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"pad%s\"}}", TRACE_PADS, i, tracePadNames[i]);
+    }
+
+    TraceBuffer *buffer = traceBuffers;
+    while (buffer != NULL) {
+        fprintf(fp, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", TRACE_THREADS, buffer->tid, buffer->threadName);
+        for (int i = 0; i < buffer->count; i++) {
+            TraceEvent *e = &buffer->events[i];
+            int tid = e->object != NULL ? TraceObjectTrack(e->object) : e->tid;
+            fprintf(fp, ",\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%ld", e->phase, e->pid, tid, e->ts);
+            if (e->object != NULL) {
+                fprintf(fp, ",\"cat\":\"lock\",\"name\":\"%s\"", e->name);
+            } else {
+                fprintf(fp, ",\"cat\":\"%s\",\"name\":\"%s\"", e->pid == TRACE_PADS ? "job" : "thread", e->name);
+            }
+            if (e->phase == 'X') {
+                fprintf(fp, ",\"dur\":%ld", e->dur);
+            } else {
+                fprintf(fp, ",\"s\":\"t\"");
+            }
+            if (e->id != 0) {
+                fprintf(fp, ",\"args\":{\"id\":\"%" PRIu64 "\"}", e->id);
+            }
+            fprintf(fp, "}");
+        }
+
+        TraceBuffer *next = buffer->next;
+        free(buffer->events);
+        free(buffer);
+        buffer = next;
+    }
+    traceBuffers = NULL;
+
+    /* name the lock tracks last, the unnamed locks get theirs while the events are written */
+    for (int i = 0; i < traceObjectCount; i++) {
+        fprintf(fp, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", TRACE_LOCKS, i, traceObjectNames[i]);
+    }
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    return TRUE;
+}